@@ -16,6 +16,7 @@
 #include "Interfaces/ITextureFormatModule.h"
 #include "TextureCompressorModule.h"
 #include "PixelFormat.h"
+#include "Async/ParallelFor.h" // FB Bulgakov - Texture2D Array
 
 #if PLATFORM_WINDOWS || PLATFORM_LINUX || PLATFORM_MAC
 	#define SUPPORTS_ISPC_ASTC	1
@@ -152,58 +153,113 @@ static uint16 GetQualityVersion(int32 OverrideSizeValue = -1)
 	return ((OverrideSizeValue >= 0 ? OverrideSizeValue : GetDefaultCompressionBySizeValue()) << 13) | (GetDefaultCompressionBySpeedValue() << 10);
 }
 
-static bool CompressSliceToASTC(
+// FB Bulgakov Begin - Texture2D Array
+/** Number of attempts to open an intermediate file before giving up, ~10ms apart. */
+#define ASTC_FILE_WRITER_MAX_ATTEMPTS 500
+
+static FArchive* CreateIntermediateFileWriter(const FString& FilePath)
+{
+	for (int32 Attempt = 0; Attempt < ASTC_FILE_WRITER_MAX_ATTEMPTS; ++Attempt)
+	{
+		FArchive* File = IFileManager::Get().CreateFileWriter(*FilePath);   // Occasionally returns NULL due to error code ERROR_SHARING_VIOLATION
+		if (File)
+		{
+			return File;
+		}
+		FPlatformProcess::Sleep(0.01f);                                        // ... no choice but to wait for the file to become free to access
+	}
+
+	UE_LOG(LogTextureFormatASTC, Error, TEXT("Failed to open '%s' for writing."), *FilePath);
+	return NULL;
+}
+
+/**
+ * Compresses all slices of an image with a single run of astcenc, arrays are passed with -array
+ * and come back as one 3D image whose 2D blocks are stored slice after slice.
+ */
+static bool CompressSlicesToASTC(
 	const void* SourceData,
 	int32 SizeX,
 	int32 SizeY,
+	int32 NumSlices,
 	FString CompressionParameters,
 	TArray<uint8>& OutCompressedData
 )
 {
-	// Always Y-invert the image prior to compression for proper orientation post-compression
-	TArray<uint8> LineBuffer;
-	LineBuffer.AddUninitialized(16384 * 4);
-	uint32 LineSize = SizeX * 4;
-	for (int32 LineIndex = 0; LineIndex < (SizeY / 2); LineIndex++)
+	FGuid Guid;
+	FPlatformMisc::CreateGuid(Guid);
+	const FString FileBasePath = FPaths::ProjectIntermediateDir() + FString::Printf(TEXT("Cache/%08x-%08x-%08x-%08x-RGBToASTC"), Guid.A, Guid.B, Guid.C, Guid.D);
+	FString InputFilePath = FileBasePath + TEXT("In.png");
+	FString OutputFilePath = FileBasePath + TEXT("Out.astc");
+
+	// astcenc reads the slices of an array from <name>_<index>.png
+	TArray<FString> SliceFilePaths;
+	for (int32 SliceIndex = 0; SliceIndex < NumSlices; ++SliceIndex)
 	{
-		uint8* LineData0 = ((uint8*)SourceData) + (LineSize * LineIndex);
-		uint8* LineData1 = ((uint8*)SourceData) + (LineSize * (SizeY - LineIndex - 1));
-		FMemory::Memcpy(LineBuffer.GetData(), LineData0, LineSize);
-		FMemory::Memcpy(LineData0, LineData1, LineSize);
-		FMemory::Memcpy(LineData1, LineBuffer.GetData(), LineSize);
+		SliceFilePaths.Add(NumSlices > 1 ? FString::Printf(TEXT("%sIn_%d.png"), *FileBasePath, SliceIndex) : InputFilePath);
 	}
-	
-	// Compress and retrieve the PNG data to write out to disk
-	TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::PNG);
-	ImageWrapper->SetRaw(SourceData, SizeX * SizeY * 4, SizeX, SizeY, ERGBFormat::RGBA, 8);
-	const TArray<uint8>& FileData = ImageWrapper->GetCompressed();
-	int32 FileDataSize = FileData.Num();
 
-	FGuid Guid;
-	FPlatformMisc::CreateGuid(Guid);
-	FString InputFilePath = FString::Printf(TEXT("Cache/%08x-%08x-%08x-%08x-RGBToASTCIn.png"), Guid.A, Guid.B, Guid.C, Guid.D);
-	FString OutputFilePath = FString::Printf(TEXT("Cache/%08x-%08x-%08x-%08x-RGBToASTCOut.astc"), Guid.A, Guid.B, Guid.C, Guid.D);
+	// Encode and write all slices in parallel
+	const uint32 LineSize = SizeX * 4;
+	const int32 SliceSize = LineSize * SizeY;
+	FThreadSafeCounter NumFailedSlices;
+	ParallelFor(NumSlices, [&](int32 SliceIndex)
+	{
+		uint8* SliceData = ((uint8*)SourceData) + SliceIndex * SliceSize;
+
+		// Always Y-invert the image prior to compression for proper orientation post-compression
+		TArray<uint8> LineBuffer;
+		LineBuffer.AddUninitialized(LineSize);
+		for (int32 LineIndex = 0; LineIndex < (SizeY / 2); LineIndex++)
+		{
+			uint8* LineData0 = SliceData + (LineSize * LineIndex);
+			uint8* LineData1 = SliceData + (LineSize * (SizeY - LineIndex - 1));
+			FMemory::Memcpy(LineBuffer.GetData(), LineData0, LineSize);
+			FMemory::Memcpy(LineData0, LineData1, LineSize);
+			FMemory::Memcpy(LineData1, LineBuffer.GetData(), LineSize);
+		}
+
+		// Compress and retrieve the PNG data to write out to disk
+		TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::PNG);
+		ImageWrapper->SetRaw(SliceData, SliceSize, SizeX, SizeY, ERGBFormat::RGBA, 8);
+		const TArray<uint8>& FileData = ImageWrapper->GetCompressed();
+
+		FArchive* PNGFile = CreateIntermediateFileWriter(SliceFilePaths[SliceIndex]);
+		if (PNGFile)
+		{
+			PNGFile->Serialize((void*)FileData.GetData(), FileData.Num());
+			delete PNGFile;
+		}
+		else
+		{
+			NumFailedSlices.Increment();
+		}
+	});
 
-	InputFilePath  = FPaths::ProjectIntermediateDir() + InputFilePath;
-	OutputFilePath = FPaths::ProjectIntermediateDir() + OutputFilePath;
+	auto DeleteIntermediateFiles = [&]()
+	{
+		for (const FString& SliceFilePath : SliceFilePaths)
+		{
+			IFileManager::Get().Delete(*SliceFilePath);
+		}
+		IFileManager::Get().Delete(*OutputFilePath);
+	};
 
-	FArchive* PNGFile = NULL;
-	while (!PNGFile)
+	if (NumFailedSlices.GetValue() > 0)
 	{
-		PNGFile = IFileManager::Get().CreateFileWriter(*InputFilePath);   // Occasionally returns NULL due to error code ERROR_SHARING_VIOLATION
-		FPlatformProcess::Sleep(0.01f);                             // ... no choice but to wait for the file to become free to access
+		DeleteIntermediateFiles();
+		return false;
 	}
-	PNGFile->Serialize((void*)&FileData[0], FileDataSize);
-	delete PNGFile;
 
 	// Compress PNG file to ASTC (using the reference astcenc.exe from ARM)
-	FString Params = FString::Printf(TEXT("-c \"%s\" \"%s\" %s"),
+	FString Params = FString::Printf(TEXT("-c \"%s\" \"%s\" %s%s"),
 		*InputFilePath,
 		*OutputFilePath,
-		*CompressionParameters
+		*CompressionParameters,
+		NumSlices > 1 ? *FString::Printf(TEXT(" -array %d"), NumSlices) : TEXT("")
 	);
 
-	UE_LOG(LogTextureFormatASTC, Display, TEXT("Compressing to ASTC (options = '%s')..."), *CompressionParameters);
+	UE_LOG(LogTextureFormatASTC, Display, TEXT("Compressing %d slice(s) to ASTC (options = '%s')..."), NumSlices, *CompressionParameters);
 
 	// Start Compressor
 #if PLATFORM_MAC
@@ -221,6 +277,7 @@ static bool CompressSliceToASTC(
 	if (!Proc.IsValid())
 	{
 		UE_LOG(LogTextureFormatASTC, Error, TEXT("Failed to start astcenc for compressing images (%s)"), *CompressorPath);
+		DeleteIntermediateFiles();
 		return false;
 	}
 
@@ -232,75 +289,65 @@ static bool CompressSliceToASTC(
 	}
 
 	// Did it work?
-	bool bConversionWasSuccessful = (ReturnCode == 0);
+	if (ReturnCode != 0)
+	{
+		UE_LOG(LogTextureFormatASTC, Error, TEXT("ASTC encoder failed with return code %d, mip size (%d, %d, %d). Leaving '%s' for testing."), ReturnCode, SizeX, SizeY, NumSlices, *SliceFilePaths[0]);
+		return false;
+	}
 
-	// Open compressed file and put the data in OutCompressedImage
-	if (bConversionWasSuccessful)
+	// Get raw file data
+	TArray<uint8> ASTCData;
+	FFileHelper::LoadFileToArray(ASTCData, *OutputFilePath);
+	DeleteIntermediateFiles();
+
+	check(sizeof(FASTCHeader) == 16);
+	if (ASTCData.Num() < (int32)sizeof(FASTCHeader))
 	{
-		// Get raw file data
-		TArray<uint8> ASTCData;
-		FFileHelper::LoadFileToArray(ASTCData, *OutputFilePath);
-			
-		// Process it
-		FASTCHeader* Header = (FASTCHeader*)ASTCData.GetData();
-			
-		// Fiddle with the texel count data to get the right value
-		uint32 TexelCountX =
-			(Header->TexelCountX[0] <<  0) + 
-			(Header->TexelCountX[1] <<  8) + 
-			(Header->TexelCountX[2] << 16);
-		uint32 TexelCountY =
-			(Header->TexelCountY[0] <<  0) + 
-			(Header->TexelCountY[1] <<  8) + 
-			(Header->TexelCountY[2] << 16);
-		uint32 TexelCountZ =
-			(Header->TexelCountZ[0] <<  0) + 
-			(Header->TexelCountZ[1] <<  8) + 
-			(Header->TexelCountZ[2] << 16);
-
-//		UE_LOG(LogTextureFormatASTC, Display, TEXT("    Compressed Texture Header:"));
-//		UE_LOG(LogTextureFormatASTC, Display, TEXT("             Magic: %x"), Header->Magic);
-//		UE_LOG(LogTextureFormatASTC, Display, TEXT("        BlockSizeX: %u"), Header->BlockSizeX);
-//		UE_LOG(LogTextureFormatASTC, Display, TEXT("        BlockSizeY: %u"), Header->BlockSizeY);
-//		UE_LOG(LogTextureFormatASTC, Display, TEXT("        BlockSizeZ: %u"), Header->BlockSizeZ);
-//		UE_LOG(LogTextureFormatASTC, Display, TEXT("       TexelCountX: %u"), TexelCountX);
-//		UE_LOG(LogTextureFormatASTC, Display, TEXT("       TexelCountY: %u"), TexelCountY);
-//		UE_LOG(LogTextureFormatASTC, Display, TEXT("       TexelCountZ: %u"), TexelCountZ);
-
-		// Calculate size of this mip in blocks
-		uint32 MipSizeX = (TexelCountX + Header->BlockSizeX - 1) / Header->BlockSizeX;
-		uint32 MipSizeY = (TexelCountY + Header->BlockSizeY - 1) / Header->BlockSizeY;
-
-		// A block is always 16 bytes
-		uint32 MipSize = MipSizeX * MipSizeY * 16;
-
-		// Copy the compressed data
-		OutCompressedData.Empty(MipSize);
-		OutCompressedData.AddUninitialized(MipSize);
-		void* MipData = OutCompressedData.GetData();
-
-		// Calculate the offset to get to the mip data
-		check(sizeof(FASTCHeader) == 16);
-		check(ASTCData.Num() == (sizeof(FASTCHeader) + MipSize));
-		FMemory::Memcpy(MipData, ASTCData.GetData() + sizeof(FASTCHeader), MipSize);
-
-		// Delete intermediate files
-		IFileManager::Get().Delete(*InputFilePath);
-		IFileManager::Get().Delete(*OutputFilePath);
+		UE_LOG(LogTextureFormatASTC, Error, TEXT("ASTC encoder output '%s' is invalid."), *OutputFilePath);
+		return false;
+	}
+
+	// Process it
+	FASTCHeader* Header = (FASTCHeader*)ASTCData.GetData();
+
+	// Fiddle with the texel count data to get the right value
+	uint32 TexelCountX =
+		(Header->TexelCountX[0] <<  0) + 
+		(Header->TexelCountX[1] <<  8) + 
+		(Header->TexelCountX[2] << 16);
+	uint32 TexelCountY =
+		(Header->TexelCountY[0] <<  0) + 
+		(Header->TexelCountY[1] <<  8) + 
+		(Header->TexelCountY[2] << 16);
+	uint32 TexelCountZ =
+		(Header->TexelCountZ[0] <<  0) + 
+		(Header->TexelCountZ[1] <<  8) + 
+		(Header->TexelCountZ[2] << 16);
+	if (Header->BlockSizeZ != 1 || TexelCountZ != (uint32)NumSlices)
+	{
+		UE_LOG(LogTextureFormatASTC, Error, TEXT("ASTC encoder output '%s' has %u slice(s) in blocks of depth %u, expected %d slice(s) in blocks of depth 1."), *OutputFilePath, TexelCountZ, (uint32)Header->BlockSizeZ, NumSlices);
+		return false;
 	}
-	else
+
+	// Calculate size of this mip in blocks
+	uint32 MipSizeX = (TexelCountX + Header->BlockSizeX - 1) / Header->BlockSizeX;
+	uint32 MipSizeY = (TexelCountY + Header->BlockSizeY - 1) / Header->BlockSizeY;
+
+	// A block is always 16 bytes, blocks of the slices follow each other
+	uint32 MipSize = MipSizeX * MipSizeY * 16 * TexelCountZ;
+
+	// Copy the compressed data, past the header
+	if (ASTCData.Num() != (int32)(sizeof(FASTCHeader) + MipSize))
 	{
-		UE_LOG(LogTextureFormatASTC, Error, TEXT("ASTC encoder failed with return code %d, mip size (%d, %d). Leaving '%s' for testing."), ReturnCode, SizeX, SizeY, *InputFilePath);
-// 		IFileManager::Get().Delete(*InputFilePath);
-// 		IFileManager::Get().Delete(*OutputFilePath);
+		UE_LOG(LogTextureFormatASTC, Error, TEXT("ASTC encoder output '%s' is %d bytes, expected %u bytes for mip size (%u, %u, %u)."), *OutputFilePath, ASTCData.Num(), (uint32)(sizeof(FASTCHeader) + MipSize), TexelCountX, TexelCountY, TexelCountZ);
 		return false;
 	}
-		
-	// Delete intermediate files
-	IFileManager::Get().Delete(*InputFilePath);
-	IFileManager::Get().Delete(*OutputFilePath);
+	OutCompressedData.Empty(MipSize);
+	OutCompressedData.AddUninitialized(MipSize);
+	FMemory::Memcpy(OutCompressedData.GetData(), ASTCData.GetData() + sizeof(FASTCHeader), MipSize);
 	return true;
 }
+// FB Bulgakov End
 
 /**
  * ASTC texture format handler.
@@ -400,21 +447,17 @@ public:
 			CompressionParameters = FString::Printf(TEXT("%s -esw bg00 -ch 1 1 0 0 -oplimit 1000 -mincorrel 0.99 -dblimit 60 -b 2.5 -v 3 1 1 0 50 0 -va 1 1 0 50"), *GetQualityString(FORCED_NORMAL_MAP_COMPRESSION_SIZE_VALUE, -1));
 		}
 
-		// Compress the image, slice by slice
-		bool bCompressionSucceeded = true;
-		int32 SliceSizeInTexels = Image.SizeX * Image.SizeY;
-		for (int32 SliceIndex = 0; SliceIndex < Image.NumSlices && bCompressionSucceeded; ++SliceIndex)
-		{
-			TArray<uint8> CompressedSliceData;
-			bCompressionSucceeded = CompressSliceToASTC(
-				Image.AsBGRA8() + (SliceIndex * SliceSizeInTexels),
-				Image.SizeX,
-				Image.SizeY,
-				CompressionParameters,
-				CompressedSliceData
-			);
-			OutCompressedImage.RawData.Append(CompressedSliceData);
-		}
+		// FB Bulgakov Begin - Texture2D Array
+		// Compress all the slices at once
+		bool bCompressionSucceeded = CompressSlicesToASTC(
+			Image.AsBGRA8(),
+			Image.SizeX,
+			Image.SizeY,
+			Image.NumSlices,
+			CompressionParameters,
+			OutCompressedImage.RawData
+		);
+		// FB Bulgakov End
 
 		if (bCompressionSucceeded)
 		{
@@ -11,6 +11,10 @@
 #include "PixelFormat.h"
 #include "TextureConverter.h"
 #include "HAL/PlatformProcess.h"
+// FB Bulgakov Begin - Texture2D Array
+#include "Misc/ScopeLock.h"
+#include "Async/ParallelFor.h"
+// FB Bulgakov End
 
 DEFINE_LOG_CATEGORY_STATIC(LogTextureFormatAndroid, Log, All);
 
@@ -44,20 +48,31 @@ static FName GSupportedTextureFormatNames[] =
 #undef ENUM_SUPPORTED_FORMATS
 
 
+// FB Bulgakov Begin - Texture2D Array
+/**
+ * Computes the size of an image compressed by CompressImageUsingQonvert.
+ */
+static int32 GetQonvertCompressedSize(EPixelFormat PixelFormat, int32 SizeX, int32 SizeY)
+{
+	const int32 BlockBytes = (PixelFormat == PF_ATC_RGBA_E || PixelFormat == PF_ATC_RGBA_I || PixelFormat == PF_ETC2_RGBA) ? 16 : 8;
+	return FMath::Max(SizeX / 4, 1) * FMath::Max(SizeY / 4, 1) * BlockBytes;
+}
+// FB Bulgakov End
+
 /**
  * Compresses an image using Qonvert.
  * @param SourceData			Source texture data to compress, in BGRA 8bit per channel unsigned format.
  * @param PixelFormat			Texture format
  * @param SizeX					Number of texels along the X-axis
  * @param SizeY					Number of texels along the Y-axis
- * @param OutCompressedData		Compressed image data output by Qonvert.
+ * @param OutCompressedData		Compressed image data output by Qonvert, must hold GetQonvertCompressedSize bytes.
  */
 static bool CompressImageUsingQonvert(
 	const void* SourceData,
 	EPixelFormat PixelFormat,
 	int32 SizeX,
 	int32 SizeY,
-	TArray<uint8>& OutCompressedData
+	uint8* OutCompressedData // FB Bulgakov - Texture2D Array
 	)
 {
 	// Avoid dependency on GPixelFormats in RenderCore.
@@ -68,9 +83,8 @@ static bool CompressImageUsingQonvert(
 	const int32 ImageBlocksX = FMath::Max(SizeX / BlockSizeX, 1);
 	const int32 ImageBlocksY = FMath::Max(SizeY / BlockSizeY, 1);
 
-	// Allocate space to store compressed data.
-	OutCompressedData.Empty(ImageBlocksX * ImageBlocksY * BlockBytes);
-	OutCompressedData.AddUninitialized(ImageBlocksX * ImageBlocksY * BlockBytes);
+	// Space to store compressed data is allocated by the caller.
+	check(ImageBlocksX * ImageBlocksY * BlockBytes == GetQonvertCompressedSize(PixelFormat, SizeX, SizeY)); // FB Bulgakov - Texture2D Array
 
 	TQonvertImage SrcImg;
 	TQonvertImage DstImg;
@@ -87,7 +101,7 @@ static bool CompressImageUsingQonvert(
 	DstImg.nWidth    = SizeX;
 	DstImg.nHeight   = SizeY;
 	DstImg.nDataSize = ImageBlocksX * ImageBlocksY * BlockBytes;
-	DstImg.pData     = OutCompressedData.GetData();
+	DstImg.pData     = OutCompressedData; // FB Bulgakov - Texture2D Array
 
 	switch (PixelFormat)
 	{
@@ -114,6 +128,12 @@ static bool CompressImageUsingQonvert(
 		return false;
 	}
 
+	// FB Bulgakov Begin - Texture2D Array
+	// Qonvert is not documented as thread safe, calls from parallel texture builds and slices are serialized.
+	static FCriticalSection QonvertCriticalSection;
+	FScopeLock QonvertLock(&QonvertCriticalSection);
+	// FB Bulgakov End
+
 	if (Qonvert(&SrcImg, &DstImg) != Q_SUCCESS)
 	{
 		return false;
@@ -161,9 +181,6 @@ class FTextureFormatAndroid : public ITextureFormat
 		FCompressedImage2D& OutCompressedImage
 		) const override
 	{
-		FImage Image;
-		InImage.CopyTo(Image, ERawImageFormat::BGRA8, BuildSettings.GetGammaSpace());
-
 		EPixelFormat CompressedPixelFormat = PF_Unknown;
 
 		if (BuildSettings.TextureFormatName == GTextureFormatNameAutoETC1)
@@ -171,6 +188,8 @@ class FTextureFormatAndroid : public ITextureFormat
 			if (bImageHasAlphaChannel)
 			{
 				// ETC1 can't support an alpha channel, store uncompressed
+				FImage Image; // FB Bulgakov - Texture2D Array
+				InImage.CopyTo(Image, ERawImageFormat::BGRA8, BuildSettings.GetGammaSpace()); // FB Bulgakov - Texture2D Array
 				OutCompressedImage.SizeX = Image.SizeX;
 				OutCompressedImage.SizeY = Image.SizeY;
 				OutCompressedImage.SizeZ = (BuildSettings.bVolume || BuildSettings.bTexture2DArray) ? Image.NumSlices : 1; // FB Bulgakov - Texture2D Array
@@ -230,26 +249,44 @@ class FTextureFormatAndroid : public ITextureFormat
 
 		check(CompressedPixelFormat != PF_Unknown);
 
-		bool bCompressionSucceeded = true;
-		int32 SliceSize = Image.SizeX * Image.SizeY;
-		for (int32 SliceIndex = 0; SliceIndex < Image.NumSlices && bCompressionSucceeded; ++SliceIndex)
+		// FB Bulgakov Begin - Texture2D Array
+		// Slices are converted in parallel and compressed straight to their offset in the output.
+		// Qonvert itself runs one slice at a time, the conversion of the other slices overlaps with it.
+		const int32 CompressedSliceSize = GetQonvertCompressedSize(CompressedPixelFormat, InImage.SizeX, InImage.SizeY);
+		OutCompressedImage.RawData.Empty(CompressedSliceSize * InImage.NumSlices);
+		OutCompressedImage.RawData.AddUninitialized(CompressedSliceSize * InImage.NumSlices);
+
+		const int32 SrcSliceSize = InImage.RawData.Num() / InImage.NumSlices;
+		FThreadSafeCounter NumFailedSlices;
+		ParallelFor(InImage.NumSlices, [&](int32 SliceIndex)
 		{
-			TArray<uint8> CompressedSliceData;
-			bCompressionSucceeded = CompressImageUsingQonvert(
-				Image.AsBGRA8() + SliceIndex * SliceSize,
+			FImage SrcSlice(InImage.SizeX, InImage.SizeY, 1, InImage.Format, InImage.GammaSpace);
+			FMemory::Memcpy(SrcSlice.RawData.GetData(), InImage.RawData.GetData() + SliceIndex * SrcSliceSize, SrcSliceSize);
+
+			FImage Slice;
+			SrcSlice.CopyTo(Slice, ERawImageFormat::BGRA8, BuildSettings.GetGammaSpace());
+
+			const bool bSliceSucceeded = CompressImageUsingQonvert(
+				Slice.AsBGRA8(),
 				CompressedPixelFormat,
-				Image.SizeX,
-				Image.SizeY,
-				CompressedSliceData
+				Slice.SizeX,
+				Slice.SizeY,
+				OutCompressedImage.RawData.GetData() + SliceIndex * CompressedSliceSize
 				);
-			OutCompressedImage.RawData.Append(CompressedSliceData);
-		}
+			if (!bSliceSucceeded)
+			{
+				NumFailedSlices.Increment();
+			}
+		});
+
+		const bool bCompressionSucceeded = NumFailedSlices.GetValue() == 0;
+		// FB Bulgakov End
 
 		if (bCompressionSucceeded)
 		{
-			OutCompressedImage.SizeX = FMath::Max(Image.SizeX, 4);
-			OutCompressedImage.SizeY = FMath::Max(Image.SizeY, 4);
-			OutCompressedImage.SizeZ = (BuildSettings.bVolume || BuildSettings.bTexture2DArray) ? Image.NumSlices : 1; // FB Bulgakov - Texture2D Array
+			OutCompressedImage.SizeX = FMath::Max(InImage.SizeX, 4); // FB Bulgakov - Texture2D Array
+			OutCompressedImage.SizeY = FMath::Max(InImage.SizeY, 4); // FB Bulgakov - Texture2D Array
+			OutCompressedImage.SizeZ = (BuildSettings.bVolume || BuildSettings.bTexture2DArray) ? InImage.NumSlices : 1; // FB Bulgakov - Texture2D Array
 			OutCompressedImage.PixelFormat = CompressedPixelFormat;
 		}
 
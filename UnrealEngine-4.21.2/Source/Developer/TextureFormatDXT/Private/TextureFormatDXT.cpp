@@ -6,6 +6,9 @@
 #include "Stats/Stats.h"
 #include "Async/AsyncWork.h"
 #include "HAL/IConsoleManager.h"
+#include "HAL/ThreadSafeCounter64.h" // FB Bulgakov - Texture2D Array
+#include "Async/ParallelFor.h" // FB Bulgakov - Texture2D Array
+#include "ProfilingDebugging/CookStats.h" // FB Bulgakov - Texture2D Array
 #include "ImageCore.h"
 #include "Modules/ModuleManager.h"
 #include "Interfaces/ITextureFormat.h"
@@ -275,7 +278,70 @@ namespace CompressionSettings
 		BlocksPerBatch,
 		TEXT("The number of blocks to compress in parallel for DXT compression.")
 		);
+
+	// FB Bulgakov Begin - Texture2D Array
+	int32 ParallelSlices = 1;
+	FAutoConsoleVariableRef ParallelSlices_CVar(
+		TEXT("Tex.AsyncDXTParallelSlices"),
+		ParallelSlices,
+		TEXT("If non-zero, the slices of texture arrays and volumes are DXT compressed in parallel.")
+		);
+	// FB Bulgakov End
+}
+
+// FB Bulgakov Begin - Texture2D Array
+#if ENABLE_COOK_STATS
+namespace DXTCookStats
+{
+	/** The times only cover the slices compressed on the slice ParallelFor, the batches of larger slices run in parallel on their own. */
+	static FThreadSafeCounter64 NumSlices;
+	static FThreadSafeCounter64 WallCycles;
+	static FThreadSafeCounter64 SliceCycles;
+	static FThreadSafeCounter64 NumBatchedSlices;
+	static FCookStatsManager::FAutoRegisterCallback RegisterCookStats([](FCookStatsManager::AddStatFuncRef AddStat)
+	{
+		const double WallTime = FPlatformTime::ToSeconds64(WallCycles.GetValue());
+		const double SliceTime = FPlatformTime::ToSeconds64(SliceCycles.GetValue());
+		AddStat(TEXT("DXT.SliceCompression"), FCookStatsManager::CreateKeyValueArray(
+			TEXT("NumParallelSlices"), NumSlices.GetValue(),
+			TEXT("NumBatchedSlices"), NumBatchedSlices.GetValue(),
+			TEXT("ParallelWallTimeSec"), WallTime,
+			TEXT("ParallelSliceTimeSec"), SliceTime,
+			TEXT("ParallelSpeedup"), WallTime > 0.0 ? SliceTime / WallTime : 1.0
+			));
+	});
 }
+#endif
+
+/**
+ * Computes the size of an image compressed by CompressImageUsingNVTT.
+ */
+static int32 GetNVTTCompressedSize(EPixelFormat PixelFormat, int32 SizeX, int32 SizeY)
+{
+	const int32 BlockBytes = (PixelFormat == PF_DXT1 || PixelFormat == PF_BC4) ? 8 : 16;
+	return FMath::Max(SizeX / 4, 1) * FMath::Max(SizeY / 4, 1) * BlockBytes;
+}
+
+/**
+ * Computes the number of batches CompressImageUsingNVTT splits an image into, 0 if it compresses it with a single compressor.
+ */
+static int32 GetNVTTNumBatches(int32 SizeX, int32 SizeY)
+{
+	const int32 ImageBlocksX = FMath::Max(SizeX / 4, 1);
+	const int32 ImageBlocksY = FMath::Max(SizeY / 4, 1);
+	const int32 BlocksPerBatch = FMath::Max<int32>(ImageBlocksX, FMath::RoundUpToPowerOfTwo(CompressionSettings::BlocksPerBatch));
+	const int32 RowsPerBatch = BlocksPerBatch / ImageBlocksX;
+	const int32 NumBatches = ImageBlocksY / RowsPerBatch;
+
+	if (ImageBlocksX * ImageBlocksY <= BlocksPerBatch ||
+		BlocksPerBatch % ImageBlocksX != 0 ||
+		RowsPerBatch * NumBatches != ImageBlocksY)
+	{
+		return 0;
+	}
+	return NumBatches;
+}
+// FB Bulgakov End
 
 /**
  * Compresses an image using NVTT.
@@ -285,7 +351,8 @@ namespace CompressionSettings
  * @param SizeY					Number of texels along the Y-axis
  * @param bSRGB					Whether the texture is in SRGB space
  * @param bIsNormalMap			Whether the texture is a normal map
- * @param OutCompressedData		Compressed image data output by nvtt.
+ * @param OutCompressedData		Compressed image data output by nvtt, must hold GetNVTTCompressedSize bytes for each slice.
+ * @param NumSlices				Number of slices stored one after another, only images compressed in batches can have more than one.
  */
 static bool CompressImageUsingNVTT(
 	const void* SourceData,
@@ -295,7 +362,10 @@ static bool CompressImageUsingNVTT(
 	bool bSRGB,
 	bool bIsNormalMap,
 	bool bIsPreview,
-	TArray<uint8>& OutCompressedData
+	// FB Bulgakov Begin - Texture2D Array
+	uint8* OutCompressedData,
+	int32 NumSlices = 1
+	// FB Bulgakov End
 	)
 {
 	check(PixelFormat == PF_DXT1 || PixelFormat == PF_DXT3 || PixelFormat == PF_DXT5 || PixelFormat == PF_BC4 || PixelFormat == PF_BC5);
@@ -308,16 +378,19 @@ static bool CompressImageUsingNVTT(
 	const int32 ImageBlocksY = FMath::Max(SizeY / BlockSizeY, 1);
 	const int32 BlocksPerBatch = FMath::Max<int32>(ImageBlocksX, FMath::RoundUpToPowerOfTwo(CompressionSettings::BlocksPerBatch));
 	const int32 RowsPerBatch = BlocksPerBatch / ImageBlocksX;
-	const int32 NumBatches = ImageBlocksY / RowsPerBatch;
+	// FB Bulgakov Begin - Texture2D Array
+	// Slices are contiguous in the source and the output, the batches of all slices are compressed together without waiting for each slice.
+	const int32 NumBatches = GetNVTTNumBatches(SizeX, SizeY) * NumSlices;
+	check(NumSlices == 1 || SizeY % BlockSizeY == 0);
 
-	// Allocate space to store compressed data.
-	OutCompressedData.Empty(ImageBlocksX * ImageBlocksY * BlockBytes);
-	OutCompressedData.AddUninitialized(ImageBlocksX * ImageBlocksY * BlockBytes);
+	// Space to store compressed data is allocated by the caller.
+	const int32 CompressedDataSize = ImageBlocksX * ImageBlocksY * BlockBytes;
+	check(CompressedDataSize == GetNVTTCompressedSize(PixelFormat, SizeX, SizeY));
+	// FB Bulgakov End
 
-	if (ImageBlocksX * ImageBlocksY <= BlocksPerBatch ||
-		BlocksPerBatch % ImageBlocksX != 0 ||
-		RowsPerBatch * NumBatches != ImageBlocksY)
+	if (NumBatches == 0) // FB Bulgakov - Texture2D Array
 	{
+		check(NumSlices == 1); // FB Bulgakov - Texture2D Array
 		FNVTTCompressor* Compressor = NULL;
 		{
 			FScopeLock ScopeLock(&GNVCompressionCriticalSection);
@@ -328,8 +401,8 @@ static bool CompressImageUsingNVTT(
 				SizeY,
 				bSRGB,
 				bIsNormalMap,
-				OutCompressedData.GetData(),
-				OutCompressedData.Num(),
+				OutCompressedData, // FB Bulgakov - Texture2D Array
+				CompressedDataSize, // FB Bulgakov - Texture2D Array
 				bIsPreview
 				);
 		}
@@ -351,7 +424,7 @@ static bool CompressImageUsingNVTT(
 	{
 		FScopeLock ScopeLock(&GNVCompressionCriticalSection);
 		const uint8* Src = (const uint8*)SourceData;
-		uint8* Dest = OutCompressedData.GetData();
+		uint8* Dest = OutCompressedData; // FB Bulgakov - Texture2D Array
 		for (int32 BatchIndex = 0; BatchIndex < NumBatches; ++BatchIndex)
 		{
 			new(Compressors) FNVTTCompressor(
@@ -475,21 +548,81 @@ class FTextureFormatDXT : public ITextureFormat
 
 		bool bCompressionSucceeded = true;
 		int32 SliceSize = Image.SizeX * Image.SizeY;
-		for (int32 SliceIndex = 0; SliceIndex < Image.NumSlices && bCompressionSucceeded; ++SliceIndex)
+		// FB Bulgakov Begin - Texture2D Array
+		// Slices are compressed straight to their offset in the output, which gives the same bytes as compressing them in order.
+		const int32 CompressedSliceSize = GetNVTTCompressedSize(CompressedPixelFormat, Image.SizeX, Image.SizeY);
+		OutCompressedImage.RawData.Empty(CompressedSliceSize * Image.NumSlices);
+		OutCompressedImage.RawData.AddUninitialized(CompressedSliceSize * Image.NumSlices);
+
+		// Large slices are split in batches, the batches of every slice are queued at once.
+		if (GetNVTTNumBatches(Image.SizeX, Image.SizeY) > 0 && (Image.NumSlices == 1 || (CompressionSettings::ParallelSlices != 0 && Image.SizeY % 4 == 0)))
 		{
-			TArray<uint8> CompressedSliceData;
 			bCompressionSucceeded = CompressImageUsingNVTT(
-				Image.AsBGRA8() + SliceIndex * SliceSize,
+				Image.AsBGRA8(),
 				CompressedPixelFormat,
 				Image.SizeX,
 				Image.SizeY,
 				Image.IsGammaCorrected(),
 				bIsNormalMap,
-				false, // Daniel Lamb: Testing with this set to true didn't give large performance gain to lightmaps.  Encoding of 140 lightmaps was 19.2seconds with preview 20.1 without preview.  11/30/2015
-				CompressedSliceData
+				false,
+				OutCompressedImage.RawData.GetData(),
+				Image.NumSlices
 				);
-			OutCompressedImage.RawData.Append(CompressedSliceData);
+#if ENABLE_COOK_STATS
+			if (Image.NumSlices > 1)
+			{
+				DXTCookStats::NumBatchedSlices.Add(Image.NumSlices);
+			}
+#endif
+		}
+		else
+		{
+			// Small slices use a single compressor each, they are compressed in parallel.
+			FThreadSafeCounter NumFailedSlices;
+			FThreadSafeCounter64 SliceCycles;
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+
+			ParallelFor(Image.NumSlices, [&](int32 SliceIndex)
+			{
+				const uint64 SliceStartCycles = FPlatformTime::Cycles64();
+				const bool bSliceSucceeded = CompressImageUsingNVTT(
+					Image.AsBGRA8() + SliceIndex * SliceSize,
+					CompressedPixelFormat,
+					Image.SizeX,
+					Image.SizeY,
+					Image.IsGammaCorrected(),
+					bIsNormalMap,
+					false, // Daniel Lamb: Testing with this set to true didn't give large performance gain to lightmaps.  Encoding of 140 lightmaps was 19.2seconds with preview 20.1 without preview.  11/30/2015
+					OutCompressedImage.RawData.GetData() + SliceIndex * CompressedSliceSize
+					);
+				if (!bSliceSucceeded)
+				{
+					NumFailedSlices.Increment();
+				}
+				SliceCycles.Add(FPlatformTime::Cycles64() - SliceStartCycles);
+			}, CompressionSettings::ParallelSlices == 0 || Image.NumSlices == 1);
+
+			bCompressionSucceeded = NumFailedSlices.GetValue() == 0;
+
+			if (Image.NumSlices > 1)
+			{
+				const uint64 WallCycles = FPlatformTime::Cycles64() - StartCycles;
+				UE_LOG(LogTextureFormatDXT, Verbose, TEXT("Compressed %d slices of %dx%d in %.2fms, %.2fms of slice work (%.2fx)."),
+					Image.NumSlices,
+					Image.SizeX,
+					Image.SizeY,
+					FPlatformTime::ToMilliseconds64(WallCycles),
+					FPlatformTime::ToMilliseconds64(SliceCycles.GetValue()),
+					WallCycles > 0 ? (double)SliceCycles.GetValue() / (double)WallCycles : 1.0
+					);
+#if ENABLE_COOK_STATS
+				DXTCookStats::NumSlices.Add(Image.NumSlices);
+				DXTCookStats::WallCycles.Add(WallCycles);
+				DXTCookStats::SliceCycles.Add(SliceCycles.GetValue());
+#endif
+			}
 		}
+		// FB Bulgakov End
 
 		if (bCompressionSucceeded)
 		{
@@ -7,6 +7,7 @@
 #include "Stats/Stats.h"
 #include "Async/AsyncWork.h"
 #include "Misc/ConfigCacheIni.h"
+#include "Async/ParallelFor.h" // FB Bulgakov - Texture2D Array
 #include "ImageCore.h"
 #include "Modules/ModuleManager.h"
 #include "Interfaces/ITextureFormat.h"
@@ -58,6 +59,11 @@ DEFINE_LOG_CATEGORY_STATIC(LogTextureFormatIntelISPCTexComp, Log, All);
 // BC6H, BC7, ASTC all have 16-byte block size
 #define BLOCK_SIZE_IN_BYTES 16
 
+// FB Bulgakov Begin - Texture2D Array
+// Target number of blocks compressed by a task at once
+#define ISPC_BLOCKS_PER_CHUNK 1024
+// FB Bulgakov End
+
 
 	// Bitmap compression types.
 enum EBitmapCompression
@@ -237,63 +243,20 @@ struct FMultithreadedCompression
 	{
 		if (bUseTasks)
 		{
-			class FIntelCompressWorker : public FNonAbandonableTask
-			{
-			public:
-				FIntelCompressWorker(EncoderSettingsType* pEncSettings, FImage* pInImage, FCompressedImage2D* pOutImage, int yStart, int yEnd, int SliceIndex, CompressFunction InFunctionCallback)
-				:	mpEncSettings(pEncSettings)
-				,	mpInImage(pInImage)
-				,	mpOutImage(pOutImage)
-				,	mYStart(yStart)
-				,	mYEnd(yEnd)
-				,	mSliceIndex(SliceIndex)
-				,	mCallback(InFunctionCallback)
-				{
-				}
-
-				void DoWork()
-				{
-					mCallback(mpEncSettings, mpInImage, mpOutImage, mYStart, mYEnd, mSliceIndex);
-				}
-
-				FORCEINLINE TStatId GetStatId() const
-				{
-					RETURN_QUICK_DECLARE_CYCLE_STAT(FIntelCompressWorker, STATGROUP_ThreadPoolAsyncTasks);
-				}
-
-				EncoderSettingsType*	mpEncSettings;
-				FImage*					mpInImage;
-				FCompressedImage2D*		mpOutImage;
-				int						mYStart;
-				int						mYEnd;
-				int						mSliceIndex;
-				CompressFunction		mCallback;
-			};
-			typedef FAsyncTask<FIntelCompressWorker> FIntelCompressTask;
-
-			// One less task because we'll do the final + non multiple of 4 inside this task
-			TIndirectArray<FIntelCompressTask> CompressionTasks;
-			const int NumStasksPerSlice = MultithreadSettings.iNumTasks + 1;
-			CompressionTasks.Reserve(NumStasksPerSlice * Image.NumSlices - 1);
-			for (int SliceIndex = 0; SliceIndex < Image.NumSlices; ++SliceIndex)
+			// FB Bulgakov Begin - Texture2D Array
+			// All slices are split in even chunks of scanlines, compressed on the task graph along with the calling thread.
+			// This is a plain chunked ParallelFor that returns once the chunks of this image are done. CompressImage is called
+			// once per mip, so mips only overlap when the texture compressor runs them as separate tasks.
+			const int ScansPerChunk = MultithreadSettings.iScansPerTask;
+			const int ChunksPerSlice = MultithreadSettings.iNumTasks / Image.NumSlices;
+			ParallelFor(MultithreadSettings.iNumTasks, [&](int32 ChunkIndex)
 			{
-				for (int iTask = 0; iTask < NumStasksPerSlice; ++iTask)
-				{
-					// Create a new task unless it's the last task in the last slice (that one will run on current thread, after these threads have been started)
-					if (SliceIndex < (Image.NumSlices - 1) || iTask < (NumStasksPerSlice - 1))
-					{
-						auto* AsyncTask = new(CompressionTasks) FIntelCompressTask(&EncoderSettings, &Image, &OutCompressedImage, iTask * MultithreadSettings.iScansPerTask, (iTask + 1) * MultithreadSettings.iScansPerTask, SliceIndex, FunctionCallback);
-						AsyncTask->StartBackgroundTask();
-					}
-				}
-			}
-			FunctionCallback(&EncoderSettings, &Image, &OutCompressedImage, MultithreadSettings.iScansPerTask * MultithreadSettings.iNumTasks, Image.SizeY, Image.NumSlices - 1);
-
-			// Wait for all tasks to complete
-			for (int32 TaskIndex = 0; TaskIndex < CompressionTasks.Num(); ++TaskIndex)
-			{
-				CompressionTasks[TaskIndex].EnsureCompletion();
-			}
+				const int SliceIndex = ChunkIndex / ChunksPerSlice;
+				const int yStart = (ChunkIndex % ChunksPerSlice) * ScansPerChunk;
+				const int yEnd = FMath::Min(yStart + ScansPerChunk, Image.SizeY);
+				FunctionCallback(&EncoderSettings, &Image, &OutCompressedImage, yStart, yEnd, SliceIndex);
+			});
+			// FB Bulgakov End
 		}
 		else
 		{
@@ -578,10 +541,13 @@ public:
 		OutCompressedImage.SizeX = FMath::Max(AlignedSizeX, BlockWidth);
 		OutCompressedImage.SizeY = FMath::Max(AlignedSizeY, BlockHeight);
 
-		// When we allow async tasks to execute we do so with BlockHeight lines of the image per task
-		// This isn't optimal for long thin textures, but works well with how ISPC works
-		MultithreadSettings.iScansPerTask = BlockHeight;
-		MultithreadSettings.iNumTasks = FMath::Max((AlignedSizeY / MultithreadSettings.iScansPerTask) - 1, 0);
+		// FB Bulgakov Begin - Texture2D Array
+		// When we allow async tasks to execute we do so with chunks of about ISPC_BLOCKS_PER_CHUNK blocks,
+		// a whole number of block rows so long thin textures and small mips still split evenly
+		const int RowsPerTask = FMath::Max(ISPC_BLOCKS_PER_CHUNK / WidthInBlocks, 1);
+		MultithreadSettings.iScansPerTask = RowsPerTask * BlockHeight;
+		MultithreadSettings.iNumTasks = FMath::DivideAndRoundUp(HeightInBlocks, RowsPerTask) * InImage.NumSlices;
+		// FB Bulgakov End
 	}
 
 	static void PadImageToBlockSize(FImage &InOutImage, int BlockWidth, int BlockHeight, int BytesPerPixel)
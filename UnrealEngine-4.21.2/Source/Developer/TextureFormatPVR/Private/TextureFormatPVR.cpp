@@ -14,6 +14,7 @@
 #include "Interfaces/ITextureFormatModule.h"
 #include "TextureCompressorModule.h"
 #include "PixelFormat.h"
+#include "Async/ParallelFor.h" // FB Bulgakov - Texture2D Array
 
 
 #define MAX_QUALITY 4
@@ -66,109 +67,111 @@ struct FPVRHeader
 #pragma pack(pop)
 #endif
 
+// FB Bulgakov Begin - Texture2D Array
 /**
- * Converts a power-of-two image to a square format (ex: 256x512 -> 512x512). Be wary of memory waste when too many texture are not square.
+ * Computes the size a power-of-two image is converted to for compression, as a square (ex: 256x512 -> 512x512). Be wary of memory waste when too many texture are not square.
  *
- * @param Image The image to be converted to a square
- * @return true if the image was converted successfully, else false
+ * @param SizeX The width of the image
+ * @param SizeY The height of the image
+ * @return the size of the squarified image
  */
-static bool SquarifyImage(FImage& Image, uint32 MinSquareSize)
+static uint32 GetSquareSize(int32 SizeX, int32 SizeY, uint32 MinSquareSize)
 {
 	// Early out
-	if (Image.SizeX == Image.SizeY && Image.SizeX >= int32(MinSquareSize))
+	if (SizeX == SizeY && SizeX >= int32(MinSquareSize))
 	{
-		return true;
+		return SizeX;
 	}
 
 	// Figure out the squarified size
-	uint32 SquareSize = FMath::Max(Image.SizeX, Image.SizeY);
+	uint32 SquareSize = FMath::Max(SizeX, SizeY);
 	if(SquareSize < MinSquareSize)
 	{
 		SquareSize = MinSquareSize;
 	}
-	
+
 	// Calculate how many times to duplicate each row of column
-	uint32 MultX = SquareSize / Image.SizeX;
-	uint32 MultY = SquareSize / Image.SizeY;
+	uint32 MultX = SquareSize / SizeX;
+	uint32 MultY = SquareSize / SizeY;
 
 	// Only give memory overhead warning if we're actually going to use a larger image
 	// Small mips that have to be upscaled for compression only save the smaller mip for use
 	if(MultX == 1 || MultY == 1)
 	{
-		float FOverhead = float(FMath::Min(Image.SizeX, Image.SizeY)) / float(SquareSize);
+		float FOverhead = float(FMath::Min(SizeX, SizeY)) / float(SquareSize);
 		int32 POverhead = FMath::RoundToInt(100.0f - (FOverhead * 100.0f));
 		UE_LOG(LogTextureFormatPVR, Warning, TEXT("Expanding mip (%d,%d) to (%d, %d). Memory overhead: ~%d%%"),
-			Image.SizeX, Image.SizeY, SquareSize, SquareSize, POverhead);
+			SizeX, SizeY, SquareSize, SquareSize, POverhead);
 	}
 	else if (MultX != MultY)
 	{
-		float FOverhead = float(FMath::Min(Image.SizeX, Image.SizeY)) / float(FMath::Max(Image.SizeX, Image.SizeY));
+		float FOverhead = float(FMath::Min(SizeX, SizeY)) / float(FMath::Max(SizeX, SizeY));
 		int32 POverhead = FMath::RoundToInt(100.0f - (FOverhead * 100.0f));
 		UE_LOG(LogTextureFormatPVR, Warning, TEXT("Expanding mip (%d,%d) to (%d, %d). Memory overhead: ~%d%%"),
-			Image.SizeX, Image.SizeY, FMath::Max(Image.SizeX, Image.SizeY), FMath::Max(Image.SizeX, Image.SizeY), POverhead);
+			SizeX, SizeY, FMath::Max(SizeX, SizeY), FMath::Max(SizeX, SizeY), POverhead);
 	}
-	
-	// Allocate room to fill out into
-	TArray<uint32> SquareRawData;
-	SquareRawData.SetNumUninitialized(SquareSize * SquareSize * Image.NumSlices);
-	
-	int32 SourceSliceSize = Image.SizeX * Image.SizeY;
-	int32 DestSliceSize = SquareSize * SquareSize;
-	for ( int32 SliceIndex=0; SliceIndex < Image.NumSlices; ++SliceIndex )
+
+	return SquareSize;
+}
+
+/**
+ * Converts a single power-of-two slice to a square by duplicating its rows or columns.
+ *
+ * @param RectData The slice to be converted, SizeX * SizeY texels
+ * @param SquareData The converted slice, SquareSize * SquareSize texels
+ */
+static void SquarifySlice(const uint32* RectData, int32 SizeX, int32 SizeY, uint32 SquareSize, uint32* SquareData)
+{
+	uint32 MultX = SquareSize / SizeX;
+	uint32 MultY = SquareSize / SizeY;
+
+	for ( int32 Y = 0; Y < SizeY; ++Y )
 	{
-		uint32* RectData = ((uint32*)Image.RawData.GetData()) + SliceIndex * SourceSliceSize;
-		uint32* SquareData = ((uint32*)SquareRawData.GetData()) + SliceIndex * DestSliceSize;
-		for ( int32 Y = 0; Y < Image.SizeY; ++Y )
+		for ( int32 X = 0; X < SizeX; ++X )
 		{
-			for ( int32 X = 0; X < Image.SizeX; ++X )
+			uint32 SourceColor = *(RectData + Y * SizeX + X);
+
+			for ( uint32 YDup = 0; YDup < MultY; ++YDup )
 			{
-				uint32 SourceColor = *(RectData + Y * Image.SizeX + X);
-			
-				for ( uint32 YDup = 0; YDup < MultY; ++YDup )
+				for ( uint32 XDup = 0; XDup < MultX; ++XDup )
 				{
-					for ( uint32 XDup = 0; XDup < MultX; ++XDup )
-					{
-						uint32* DestColor = SquareData + ((Y * MultY + YDup) * SquareSize + (X * MultX + XDup));
-						*DestColor = SourceColor;
-					}
+					uint32* DestColor = SquareData + ((Y * MultY + YDup) * SquareSize + (X * MultX + XDup));
+					*DestColor = SourceColor;
 				}
 			}
 		}
 	}
-
-	// Put the new image data into the existing Image (copying from uint32 array to uint8 array)
-	Image.RawData.Empty(SquareSize * SquareSize * Image.NumSlices * sizeof(uint32));
-	Image.RawData.SetNumUninitialized(SquareSize * SquareSize * Image.NumSlices * sizeof(uint32));
-	uint32* FinalData = (uint32*)Image.RawData.GetData();
-	FMemory::Memcpy(Image.RawData.GetData(), SquareRawData.GetData(), SquareSize * SquareSize * Image.NumSlices * sizeof(uint32));
-
-	Image.SizeX = SquareSize;
-	Image.SizeY = SquareSize;
-
-	return true;
 }
 
-static void DeriveNormalZ(FImage& Image)
+static void DeriveNormalZ(FColor* SliceData, int32 NumTexels)
 {
-	int32 SliceSize = Image.SizeX * Image.SizeY;
-	for ( int32 SliceIndex=0; SliceIndex < Image.NumSlices; ++SliceIndex )
+	for(int32 TexelIndex = 0; TexelIndex < NumTexels; ++TexelIndex)
 	{
-		FColor* RectData = (FColor*)Image.RawData.GetData() + SliceIndex * SliceSize;
-		for(int32 Y = 0; Y < Image.SizeY; ++Y)
-		{
-			for(int32 X = 0; X < Image.SizeX; ++X)
-			{
-				FColor& SourceColor = *(RectData + Y * Image.SizeX + X);
+		FColor& SourceColor = SliceData[TexelIndex];
 
-				const float NormalX = SourceColor.R / 255.0f * 2 - 1;
-				const float NormalY = SourceColor.G / 255.0f * 2 - 1;
-				const float NormalZ = FMath::Sqrt(FMath::Clamp<float>(1 - (NormalX * NormalX + NormalY * NormalY), 0, 1));
-				SourceColor.B = FMath::TruncToInt((NormalZ + 1) / 2.0f * 255.0f);
-			}
-		}
+		const float NormalX = SourceColor.R / 255.0f * 2 - 1;
+		const float NormalY = SourceColor.G / 255.0f * 2 - 1;
+		const float NormalZ = FMath::Sqrt(FMath::Clamp<float>(1 - (NormalX * NormalX + NormalY * NormalY), 0, 1));
+		SourceColor.B = FMath::TruncToInt((NormalZ + 1) / 2.0f * 255.0f);
 	}
 }
 
+/**
+ * Computes the size of a mip compressed by CompressImageUsingPVRTexTool.
+ */
+static uint32 GetPVRTCCompressedSize(EPixelFormat PixelFormat, int32 FinalSquareSize)
+{
+	const int32 BlockSizeX = (PixelFormat == PF_PVRTC2) ? 8 : 4;	// PVRTC2 uses 8x4 blocks, PVRTC4 uses 4x4 blocks
+	const int32 BlockSizeY = 4;
+	const int32 BlockBytes = 8;										// Both PVRTC2 and PVRTC4 are 8 bytes per block
+
+	// min 2x2 blocks per mip
+	const uint32 DestBlocksX = FGenericPlatformMath::Max<uint32>(FinalSquareSize / BlockSizeX, 2);
+	const uint32 DestBlocksY = FGenericPlatformMath::Max<uint32>(FinalSquareSize / BlockSizeY, 2);
+	return DestBlocksX * DestBlocksY * BlockBytes;
+}
+// FB Bulgakov End
+
 /**
  * Checks if the passed image is a proper power-of-2 image
  *
@@ -335,34 +338,55 @@ class FTextureFormatPVR : public ITextureFormat
 			return false;
 		}
 
-		// Squarify image
+		// FB Bulgakov Begin - Texture2D Array
+		// Squarify and compress the slices in parallel, each slice is squarified on its own into a temporary buffer
 		int32 FinalSquareSize = FGenericPlatformMath::Max(Image.SizeX, Image.SizeY);
-		SquarifyImage(Image, (CompressedPixelFormat == PF_PVRTC2) ? 16 : 8);
-		check(Image.SizeX == Image.SizeY);
+		const uint32 SquareSize = GetSquareSize(Image.SizeX, Image.SizeY, (CompressedPixelFormat == PF_PVRTC2) ? 16 : 8);
+		const bool bSquarify = (int32(SquareSize) != Image.SizeX || int32(SquareSize) != Image.SizeY);
+		const bool bDeriveNormalZ = (BuildSettings.TextureFormatName == GTextureFormatNamePVRTCN);
 
-		if ( BuildSettings.TextureFormatName == GTextureFormatNamePVRTCN )
-		{
-			// Derive Z from X and Y to be consistent with BC5 normal maps used on PC (toss the texture's actual Z)
-			DeriveNormalZ(Image);
-		}
+		const int32 SliceSize = Image.SizeX * Image.SizeY;
+		const int32 CompressedSliceSize = GetPVRTCCompressedSize(CompressedPixelFormat, FinalSquareSize);
+		OutCompressedImage.RawData.Empty(CompressedSliceSize * Image.NumSlices);
+		OutCompressedImage.RawData.AddUninitialized(CompressedSliceSize * Image.NumSlices);
 
-		bool bCompressionSucceeded = true;
-		int32 SliceSize = Image.SizeX * Image.SizeY;
-		for (int32 SliceIndex = 0; SliceIndex < Image.NumSlices && bCompressionSucceeded; ++SliceIndex)
+		FThreadSafeCounter NumFailedSlices;
+		ParallelFor(Image.NumSlices, [&](int32 SliceIndex)
 		{
-			TArray<uint8> CompressedSliceData;
-			bCompressionSucceeded = CompressImageUsingPVRTexTool(
-				Image.AsBGRA8() + SliceIndex * SliceSize,
+			FColor* SliceData = Image.AsBGRA8() + SliceIndex * SliceSize;
+
+			TArray<uint32> SquareSliceData;
+			if (bSquarify)
+			{
+				SquareSliceData.SetNumUninitialized(SquareSize * SquareSize);
+				SquarifySlice((const uint32*)SliceData, Image.SizeX, Image.SizeY, SquareSize, SquareSliceData.GetData());
+				SliceData = (FColor*)SquareSliceData.GetData();
+			}
+
+			if (bDeriveNormalZ)
+			{
+				// Derive Z from X and Y to be consistent with BC5 normal maps used on PC (toss the texture's actual Z)
+				DeriveNormalZ(SliceData, SquareSize * SquareSize);
+			}
+
+			const bool bSliceSucceeded = CompressImageUsingPVRTexTool(
+				SliceData,
 				CompressedPixelFormat,
-				Image.SizeX,
-				Image.SizeY,
+				SquareSize,
+				SquareSize,
 				Image.IsGammaCorrected(),
 				FinalSquareSize,
-				CompressedSliceData,
+				OutCompressedImage.RawData.GetData() + SliceIndex * CompressedSliceSize,
 				BuildSettings
 				);
-			OutCompressedImage.RawData.Append(CompressedSliceData);
-		}
+			if (!bSliceSucceeded)
+			{
+				NumFailedSlices.Increment();
+			}
+		});
+
+		bool bCompressionSucceeded = NumFailedSlices.GetValue() == 0;
+		// FB Bulgakov End
 
 		if ( bCompressionSucceeded )
 		{
@@ -376,7 +400,7 @@ class FTextureFormatPVR : public ITextureFormat
 		return bCompressionSucceeded;
 	}
 
-	static bool CompressImageUsingPVRTexTool( void* SourceData, EPixelFormat PixelFormat, int32 SizeX, int32 SizeY, bool bSRGB, int32 FinalSquareSize, TArray<uint8>& OutCompressedData, const struct FTextureBuildSettings& BuildSettings )
+	static bool CompressImageUsingPVRTexTool( void* SourceData, EPixelFormat PixelFormat, int32 SizeX, int32 SizeY, bool bSRGB, int32 FinalSquareSize, uint8* OutCompressedData, const struct FTextureBuildSettings& BuildSettings ) // FB Bulgakov - Texture2D Array
 	{
 		// Figure out whether to use 2 bits or 4 bits per pixel (PVRTC2/PVRTC4)
 		bool bIsPVRTC2 = (PixelFormat == PF_PVRTC2);
@@ -391,16 +415,15 @@ class FTextureFormatPVR : public ITextureFormat
 		const uint32 DestBlocksX = FGenericPlatformMath::Max<uint32>(DestSizeX / BlockSizeX, 2);
 		const uint32 DestBlocksY = FGenericPlatformMath::Max<uint32>(DestSizeY / BlockSizeY, 2);
 		const uint32 DestNumBytes = DestBlocksX * DestBlocksY * BlockBytes;
+		check(DestNumBytes == GetPVRTCCompressedSize(PixelFormat, FinalSquareSize)); // FB Bulgakov - Texture2D Array
 
 		// If using an image that's too small, compressor needs to generate mips for us with an upscaled image
 		check(SizeX == SizeY);
 		const int32 SourceSquareSize = SizeX;
 		bool bGenerateMips = (FinalSquareSize < SourceSquareSize) ? true : false;
 
-		// Allocate space to store compressed data.
-		OutCompressedData.Empty(DestNumBytes);
-		OutCompressedData.AddUninitialized(DestNumBytes);
-		void* MipData = OutCompressedData.GetData();
+		// Space to store compressed data is allocated by the caller.
+		void* MipData = OutCompressedData; // FB Bulgakov - Texture2D Array
 
 		// Write SourceData into PVR file on disk
 
@@ -2502,7 +2502,7 @@ void FMaterialEditor::OnConvertObjects()
 					ClassToCreate = UMaterialExpressionTextureSampleParameterCube::StaticClass();
 				}
 				// FB Bulgakov Begin - Texture2D Array
-				else if (TextureSampleExpression && TextureSampleExpression->Texture && TextureSampleExpression->Texture->IsA(UTexture2DArray::StaticClass()))
+				else if (TextureSampleExpression && TextureSampleExpression->Texture && TextureSampleExpression->Texture->GetMaterialType() == MCT_Texture2DArray)
 				{
 					ClassToCreate = UMaterialExpressionTextureSampleParameter2DArray::StaticClass();
 				}
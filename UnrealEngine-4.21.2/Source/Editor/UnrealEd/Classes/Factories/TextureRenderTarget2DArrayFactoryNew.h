@@ -0,0 +1,33 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectMacros.h"
+#include "Factories/Factory.h"
+#include "TextureRenderTarget2DArrayFactoryNew.generated.h"
+
+UCLASS(hidecategories = Object, MinimalAPI)
+class UTextureRenderTarget2DArrayFactoryNew : public UFactory
+{
+	GENERATED_UCLASS_BODY()
+
+	/** Width of the new render target. */
+	UPROPERTY()
+	int32 Width;
+
+	/** Height of the new render target. */
+	UPROPERTY()
+	int32 Height;
+
+	/** Number of slices of the new render target. */
+	UPROPERTY()
+	int32 Slices;
+
+	/** Pixel format of the new render target, PF_Unknown for the default HDR format. */
+	UPROPERTY()
+	TEnumAsByte<EPixelFormat> Format;
+
+	//~ Begin UFactory Interface
+	FText GetDisplayName() const override;
+	UObject* FactoryCreateNew(UClass* Class, UObject* InParent, FName Name, EObjectFlags Flags, UObject* Context, FFeedbackContext* Warn) override;
+	//~ Begin UFactory Interface
+};
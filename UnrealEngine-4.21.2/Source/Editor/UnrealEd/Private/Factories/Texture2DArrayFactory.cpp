@@ -28,13 +28,12 @@ UObject* UTexture2DArrayFactory::FactoryCreateNew(UClass* Class, UObject* InPare
 	UTexture2DArray* NewTexture2DArray = NewObject<UTexture2DArray>(InParent, Name, Flags);
 
 	NewTexture2DArray->MipGenSettings = TMGS_FromTextureGroup;
-	NewTexture2DArray->NeverStream = true;
 	NewTexture2DArray->CompressionNone = false;
 
 	NewTexture2DArray->Source2DTextures = Source2DTextures;
 
-	NewTexture2DArray->UpdateSourceFromSourceTextures();
-	NewTexture2DArray->UpdateResource();
+	// Slices are read and the array built in the background, the asset can be used right away.
+	NewTexture2DArray->UpdateSourceFromSourceTexturesAsync();
 
 	return NewTexture2DArray;
 }
@@ -0,0 +1,38 @@
+#include "Factories/TextureRenderTarget2DArrayFactoryNew.h"
+#include "Engine/TextureRenderTarget2DArray.h"
+
+#define LOCTEXT_NAMESPACE "TextureRenderTarget2DArrayFactoryNew"
+
+UTextureRenderTarget2DArrayFactoryNew::UTextureRenderTarget2DArrayFactoryNew(const FObjectInitializer& ObjectInitializer)
+ : Super(ObjectInitializer)
+{
+	bCreateNew = true;
+	bEditAfterNew = true;
+	SupportedClass = UTextureRenderTarget2DArray::StaticClass();
+
+	Width = 256;
+	Height = 256;
+	Slices = 4;
+	Format = PF_Unknown;
+}
+
+FText UTextureRenderTarget2DArrayFactoryNew::GetDisplayName() const
+{
+	return LOCTEXT("TextureRenderTarget2DArrayFactoryDescription", "Render Target 2D Array");
+}
+
+UObject* UTextureRenderTarget2DArrayFactoryNew::FactoryCreateNew(UClass* Class, UObject* InParent, FName Name, EObjectFlags Flags, UObject* Context, FFeedbackContext* Warn)
+{
+	UTextureRenderTarget2DArray* NewRenderTarget = NewObject<UTextureRenderTarget2DArray>(InParent, Name, Flags);
+
+	NewRenderTarget->SizeX = Width;
+	NewRenderTarget->SizeY = Height;
+	NewRenderTarget->Slices = Slices;
+	NewRenderTarget->OverrideFormat = Format;
+
+	NewRenderTarget->UpdateResource();
+
+	return NewRenderTarget;
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -6,6 +6,7 @@
 #include "Texture2DArray.generated.h"
 
 class FTextureResource;
+class FTexture2DArrayStreamingRequest;
 
 UCLASS(hidecategories=(Object, Compositing, ImportSettings), MinimalAPI)
 class UTexture2DArray : public UTexture
@@ -21,16 +22,57 @@ public:
 	/** A (optional) reference texture from which the texture 2D array was built */
 	UPROPERTY(EditAnywhere, Category=Source2D, meta=(DisplayName="Source Texture"))
 	TArray<UTexture2D*> Source2DTextures;
+
+	/** Source GUIDs of the slices the array source was last assembled from, used to rebuild only the slices that changed */
+	UPROPERTY()
+	TArray<FGuid> SourceSliceIds;
+
+	/**
+	 * Save only the slice references and their source GUIDs, not the assembled source.
+	 * The source is read back from Source2DTextures when the derived data has to be rebuilt.
+	 */
+	UPROPERTY(EditAnywhere, Category=Source2D, AdvancedDisplay)
+	uint8 bReferenceSliceSources:1;
 #endif
 
+	/** The addressing mode to use for the X axis. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Texture, AssetRegistrySearchable)
+	TEnumAsByte<enum TextureAddress> AddressX;
+
+	/** The addressing mode to use for the Y axis. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Texture, AssetRegistrySearchable)
+	TEnumAsByte<enum TextureAddress> AddressY;
+
 	ENGINE_API bool UpdateSourceFromSourceTextures();
 
+#if WITH_EDITOR
+	/** Whether the assembled source pixels are available, false for reference only sources that were not read back yet. */
+	FORCEINLINE bool HasSourcePayload() const { return Source.GetSizeOnDisk() > 0; }
+
+	/**
+	 * Reads the source of a reference only array back from its slice textures, keeping the source layout and GUID.
+	 *
+	 * @return	true if the source pixels are available.
+	 */
+	ENGINE_API bool LoadReferencedSourceSlices();
+
+	/**
+	 * Reassembles the source from Source2DTextures and rebuilds the platform data in the background, showing progress in a notification.
+	 * The current resource is kept while slices are read, the array has no resource while its platform data is built.
+	 */
+	ENGINE_API void UpdateSourceFromSourceTexturesAsync();
+
+	/** Whether a background source update started with UpdateSourceFromSourceTexturesAsync is running. */
+	ENGINE_API bool IsUpdatingSourceAsync() const;
+#endif
+
 	//~ Begin UObject Interface.
 	void Serialize(FArchive& Ar) override;
 	void PostLoad() override;
 	void GetAssetRegistryTags(TArray<FAssetRegistryTag>& OutTags) const override;
 	FString GetDesc() override;
 	void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+	void BeginDestroy() override;
 	//~ End UObject Interface.
 
 	/** Trivial accessors. */
@@ -94,9 +136,128 @@ public:
 
 	ENGINE_API static bool ShaderPlatformSupportsCompression(EShaderPlatform ShaderPlatform);
 
+	/** Whether the top mips of this array can be streamed in and out. */
+	bool IsStreamable() const;
+
+	/** Number of mips kept resident regardless of streaming. */
+	int32 GetNumNonStreamingMips() const;
+
+	/** Number of mips in the RHI texture, or about to be once the last applied streaming request reaches the render thread. */
+	FORCEINLINE int32 GetNumResidentMips() const { return ResidentMips; }
+
+	/** Number of mips the streamer last asked to have resident. */
+	FORCEINLINE int32 GetNumWantedMips() const { return WantedMips; }
+
+	/** Whether a streaming request is loading mips for this array. */
+	FORCEINLINE bool HasPendingStreamingRequest() const { return PendingStreamingRequest != nullptr; }
+
+	/** The last time the array was rendered, used to decide how many mips it wants. */
+	double GetLastRenderTimeForStreaming() const;
+
+	/**
+	 * Starts loading the mips needed to have NewResidentMips resident, the RHI texture is switched once they are loaded.
+	 * Dropping mips loads nothing, the resident mips are copied to a smaller RHI texture on the render thread.
+	 *
+	 * @param	NewResidentMips		Number of mips to have resident, counting from the smallest one.
+	 * @return	false if a request is already pending or nothing needs to change.
+	 */
+	bool StreamMips(int32 NewResidentMips);
+
+	/**
+	 * Queues new data for a range of mips of a slice. Updates queued during a frame reach the render thread
+	 * together at its end and are copied into the current RHI texture, mips that are not resident are skipped.
+	 * The resource keeps a copy of the data and writes it to every texture streaming swaps in, until the resource
+	 * itself is recreated, e.g. by UpdateResource.
+	 *
+	 * @param	SliceIndex	The slice to update.
+	 * @param	FirstMip	The first mip to update.
+	 * @param	MipData		One buffer per mip from FirstMip on, in the pixel format of the array with rows of blocks tightly packed.
+	 * @return	false if the slice, the mips or the size of the data don't match the array.
+	 */
+	ENGINE_API bool UpdateSlice(int32 SliceIndex, int32 FirstMip, TArray<TArray<uint8>> MipData);
+
+	/**
+	 * Hands the mips of the pending streaming request over to the resource once they are loaded.
+	 *
+	 * @return	true if a request is still pending.
+	 */
+	bool UpdateStreamingStatus();
+
+	/** Blocks until the pending streaming request, if any, is applied. */
+	void WaitForStreaming();
+
 protected:
 
+	/** Blocks until the pending streaming request, if any, is done and drops its mips. */
+	void CancelStreaming();
+
+	friend class FTexture2DArrayStreamingManager;
+	friend class FTexture2DArrayBuilder;
+	friend class FTexture2DArraySourceReadTask;
+
+	/** Number of mips in the RHI texture. */
+	int32 ResidentMips;
+
+	/** Number of mips the streamer wants resident. */
+	int32 WantedMips;
+
+	/** Streaming request loading mips for this array, if any. */
+	FTexture2DArrayStreamingRequest* PendingStreamingRequest;
+
 #if WITH_EDITOR
 	void UpdateMipGenSettings();
+
+	/**
+	 * Checks that every slice texture is set and that they all share the same source layout.
+	 *
+	 * @param	OutSizeX	Width of the slices.
+	 * @param	OutSizeY	Height of the slices.
+	 * @param	OutFormat	Source format of the slices.
+	 * @return	false if the array can't be assembled from its slices.
+	 */
+	bool GetSourceTexturesLayout(int32& OutSizeX, int32& OutSizeY, ETextureSourceFormat& OutFormat) const;
+
+	/** Whether the current array source has the given layout and can have slices written into it in place. */
+	bool CanPatchSource(int32 SizeX, int32 SizeY, ETextureSourceFormat Format) const;
+
+	/**
+	 * Whether the array source was assembled from Source2DTextures as they are now: every slice has the source GUID
+	 * it was read with and the size and format of the array source. Only reads source headers, no bulk data is loaded.
+	 */
+	bool AreSourceSlicesUpToDate() const;
+
+	/**
+	 * Rebuilds the array source in place, re-reading only the slices that were added or changed
+	 * and moving the ones that were reordered. The source layout (size, format) must be unchanged.
+	 *
+	 * @param	NewSliceIds		Source GUIDs of Source2DTextures, one per slice. Slices that were not read are invalidated.
+	 * @param	SliceSize		Size in bytes of a single source slice.
+	 */
+	void UpdateChangedSourceSlices(TArray<FGuid>& NewSliceIds, int32 SliceSize);
+
+	/**
+	 * Reads the top mip of the given slices into the locked array source, decoding them in parallel.
+	 * A texture used by several slices is read once and copied to the others.
+	 * Shows progress for large arrays and lets the user cancel, slices that were cancelled or failed to read are left blank.
+	 *
+	 * @param	SliceIndices	Indices in Source2DTextures of the slices to read.
+	 * @param	SliceSize		Size in bytes of a single source slice.
+	 * @param	SourceData		The locked array source.
+	 * @param	InOutSliceIds	Source GUIDs of the slices, the ones that were not read are invalidated so the next update reads them again.
+	 * @return	false if a slice was not read.
+	 */
+	bool ReadSliceSourceMips(const TArray<int32>& SliceIndices, int32 SliceSize, uint8* SourceData, TArray<FGuid>& InOutSliceIds);
+
+	/**
+	 * Copies the top mip of a slice texture source into the array source, zeroing it if the slice can't be read.
+	 *
+	 * @param	SliceSource			Source of the slice texture.
+	 * @param	SliceSize			Size in bytes of a single source slice.
+	 * @param	OutSliceData		Destination of the slice inside the locked array source.
+	 * @param	ScratchData			Buffer reused across calls to decode PNG compressed sources.
+	 * @param	ImageWrapperModule	Preloaded image wrapper module, required when called off the game thread.
+	 * @return	true if the slice was read.
+	 */
+	static bool ReadSliceSourceMip(FTextureSource& SliceSource, int32 SliceSize, uint8* OutSliceData, TArray<uint8>& ScratchData, class IImageWrapperModule* ImageWrapperModule);
 #endif
 };
\ No newline at end of file
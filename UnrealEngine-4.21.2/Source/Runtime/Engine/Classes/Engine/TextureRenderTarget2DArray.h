@@ -0,0 +1,92 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectMacros.h"
+#include "Engine/TextureRenderTarget.h"
+#include "TextureRenderTarget2DArray.generated.h"
+
+class FTextureResource;
+
+/**
+ * Render target texture 2D array. Each slice can be bound as a render target on its own,
+ * the whole array is sampled as a texture 2D array in materials.
+ */
+UCLASS(hidecategories=Object, hidecategories=Texture, hidecategories=Compression, hidecategories=Adjustments, hidecategories=Compositing, MinimalAPI)
+class UTextureRenderTarget2DArray : public UTextureRenderTarget
+{
+	GENERATED_UCLASS_BODY()
+
+	/** The width of the texture. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=TextureRenderTarget2DArray, AssetRegistrySearchable)
+	int32 SizeX;
+
+	/** The height of the texture. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=TextureRenderTarget2DArray, AssetRegistrySearchable)
+	int32 SizeY;
+
+	/** The number of slices of the texture. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=TextureRenderTarget2DArray, AssetRegistrySearchable, meta=(ClampMin="1"))
+	int32 Slices;
+
+	/** The color the texture is cleared to. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=TextureRenderTarget2DArray)
+	FLinearColor ClearColor;
+
+	/** The addressing mode to use for the X axis. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=TextureRenderTarget2DArray, AssetRegistrySearchable)
+	TEnumAsByte<enum TextureAddress> AddressX;
+
+	/** The addressing mode to use for the Y axis. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=TextureRenderTarget2DArray, AssetRegistrySearchable)
+	TEnumAsByte<enum TextureAddress> AddressY;
+
+	/** Whether to support storing HDR values, which requires more memory. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=TextureRenderTarget2DArray, AssetRegistrySearchable)
+	uint8 bHDR:1;
+
+	/** Whether to store the content in linear gamma, LDR targets are stored in sRGB otherwise. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=TextureRenderTarget2DArray, AdvancedDisplay)
+	uint8 bForceLinearGamma:1;
+
+	/** Format of the texture, overrides the one derived from bHDR when set. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=TextureRenderTarget2DArray, AdvancedDisplay)
+	TEnumAsByte<EPixelFormat> OverrideFormat;
+
+	/**
+	 * Initializes the render target, the resource is recreated.
+	 *
+	 * @param	InSizeX		Width of the texture.
+	 * @param	InSizeY		Height of the texture.
+	 * @param	InSlices	Number of slices.
+	 * @param	InFormat	Pixel format of the texture.
+	 */
+	ENGINE_API void Init(uint32 InSizeX, uint32 InSizeY, uint32 InSlices, EPixelFormat InFormat);
+
+	/** Recreates the resource and clears it on the render thread right away. */
+	ENGINE_API void UpdateResourceImmediate(bool bClearRenderTarget = true);
+
+	FORCEINLINE EPixelFormat GetFormat() const
+	{
+		if (OverrideFormat == PF_Unknown)
+		{
+			return bHDR ? PF_FloatRGBA : PF_B8G8R8A8;
+		}
+		return OverrideFormat;
+	}
+
+	//~ Begin UTexture Interface
+	float GetSurfaceWidth() const override { return SizeX; }
+	float GetSurfaceHeight() const override { return SizeY; }
+	FTextureResource* CreateResource() override;
+	EMaterialValueType GetMaterialType() const override { return MCT_Texture2DArray; }
+	//~ End UTexture Interface
+
+	//~ Begin UObject Interface
+#if WITH_EDITOR
+	ENGINE_API void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif // WITH_EDITOR
+	void PostLoad() override;
+	void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+	FString GetDesc() override;
+	//~ End UObject Interface
+};
@@ -2120,7 +2120,7 @@ uint32 UMaterialExpressionTextureObject::GetOutputType(int32 OutputIndex)
 		return MCT_VolumeTexture;
 	}
 	// FB Bulgakov Begin - Texture2D Array
-	else if (Cast<UTexture2DArray>(Texture) != NULL)
+	else if (Texture && Texture->GetMaterialType() == MCT_Texture2DArray)
 	{
 		return MCT_Texture2DArray;
 	}
@@ -2335,7 +2335,8 @@ bool UMaterialExpressionTextureSampleParameter2DArray::TextureIsValid(UTexture*
 	bool Result = false;
 	if (InTexture)
 	{
-		if (InTexture->IsA(UTexture2DArray::StaticClass()))
+		// Texture 2D arrays and render target 2D arrays
+		if (InTexture->GetMaterialType() == MCT_Texture2DArray)
 		{
 			Result = true;
 		}
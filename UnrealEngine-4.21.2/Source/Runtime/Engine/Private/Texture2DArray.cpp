@@ -5,13 +5,109 @@
 #include "DeviceProfiles/DeviceProfile.h"
 #include "DeviceProfiles/DeviceProfileManager.h"
 #include "Containers/ResourceArray.h"
+#include "Async/AsyncWork.h"
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Misc/ScopedSlowTask.h"
+#include "Modules/ModuleManager.h"
+#include "IImageWrapperModule.h"
+#include "ContentStreaming.h"
+#include "Texture2DArrayStreaming.h"
+#include "Serialization/MemoryReader.h"
+#include "Misc/CoreMisc.h"
+#include "Misc/CoreDelegates.h"
+#include "UObject/UObjectIterator.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Async/MappedFileHandle.h"
+#include "RHICommandList.h"
+#if WITH_EDITOR
+#include "DerivedDataCacheInterface.h"
+#include "Texture2DArrayBuilder.h"
+#endif
+
+#define LOCTEXT_NAMESPACE "Texture2DArray"
 
 const int32 MAX_TEXTURE_2D_ARRAY_SLICES = 512;
 
+/** Largest mip a texture 2D array resource starts with, the other mips are loaded by the streaming manager. */
+const int32 TEXTURE_2D_ARRAY_PLACEHOLDER_SIZE = 16;
+
+static TAutoConsoleVariable<int32> CVarTexture2DArrayStreaming(
+	TEXT("r.Texture2DArray.Streaming"),
+	1,
+	TEXT("Allows texture 2D arrays to stream their top mips in and out.\n")
+	TEXT("Arrays flagged NeverStream and arrays already resident are not affected."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarTexture2DArrayUploadBudget(
+	TEXT("r.Texture2DArray.Streaming.UploadBudgetKB"),
+	4096,
+	TEXT("Kilobytes of streamed mips a texture 2D array uploads per frame on the render thread.\n")
+	TEXT("Textures that fit in it are created with their mips at once, bigger ones are uploaded over several frames\n")
+	TEXT("and swapped in once complete. 0 creates every texture with its mips at once."),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarTexture2DArrayMapStreamedMips(
+	TEXT("r.Texture2DArray.Streaming.MapMips"),
+	1,
+	TEXT("Memory maps the streamed mips of cooked texture 2D arrays from their bulk data file when stored uncompressed,\n")
+	TEXT("instead of reading them into a copy."),
+	ECVF_Default);
+
+DECLARE_STATS_GROUP(TEXT("Texture2DArray"), STATGROUP_Texture2DArray, STATCAT_Advanced);
+
+DECLARE_MEMORY_STAT(TEXT("Resident Memory"), STAT_Texture2DArrayMemory, STATGROUP_Texture2DArray);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Arrays"), STAT_Texture2DArrayCount, STATGROUP_Texture2DArray);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Slices"), STAT_Texture2DArraySlices, STATGROUP_Texture2DArray);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Resident Mips"), STAT_Texture2DArrayResidentMips, STATGROUP_Texture2DArray);
+DECLARE_CYCLE_STAT(TEXT("Render Thread Upload"), STAT_Texture2DArrayRenderThreadUpload, STATGROUP_Texture2DArray);
+
+/** Size of a texture 2D array in video memory, each slice is laid out as a texture 2D of its own. */
+static uint32 CalcTexture2DArrayPlatformSize(uint32 SizeX, uint32 SizeY, uint32 SizeZ, EPixelFormat Format, int32 MipCount, uint32 Flags)
+{
+	uint32 TextureAlign = 0;
+	return (uint32)RHICalcTexture2DPlatformSize(SizeX, SizeY, Format, MipCount, 1, Flags, TextureAlign) * SizeZ;
+}
+
+#if WITH_EDITOR
+
+/** Reads slice texture sources into the array source, several of them run concurrently on the large thread pool. */
+class FTexture2DArraySliceReadTask : public FNonAbandonableTask
+{
+public:
+	FTexture2DArraySliceReadTask(const TFunction<void()>& InReadSlices)
+		: ReadSlices(InReadSlices)
+	{
+	}
+
+	void DoWork()
+	{
+		ReadSlices();
+	}
+
+	FORCEINLINE TStatId GetStatId() const
+	{
+		RETURN_QUICK_DECLARE_CYCLE_STAT(FTexture2DArraySliceReadTask, STATGROUP_ThreadPoolAsyncTasks);
+	}
+
+private:
+	TFunction<void()> ReadSlices;
+};
+
+#endif // WITH_EDITOR
+
 UTexture2DArray::UTexture2DArray(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
+	, ResidentMips(0)
+	, WantedMips(0)
+	, PendingStreamingRequest(nullptr)
 {
 	SRGB = true;
+#if WITH_EDITORONLY_DATA
+	bReferenceSliceSources = false;
+#endif
+	AddressX = TA_Clamp;
+	AddressY = TA_Clamp;
 }
 
 bool UTexture2DArray::UpdateSourceFromSourceTextures()
@@ -19,101 +115,484 @@ bool UTexture2DArray::UpdateSourceFromSourceTextures()
 	bool bSourceValid = false;
 
 #if WITH_EDITOR
+	// A background build would apply slices read from the source as it was.
+	FTexture2DArrayBuilder::Get().Cancel(this);
+
+	bool bSourceChanged = true;
+
 	int32 NumSlices = Source2DTextures.Num();
-	if (NumSlices > 0)
-	{
-		// Check source textures
-		bool bSourceTexturesAreValid = true;
-		int32 SizeX = -1;
-		int32 SizeY = -1;
-		int32 NumMips = -1;
-		ETextureSourceFormat TextureFormat = TSF_Invalid;
+	int32 SizeX = 0;
+	int32 SizeY = 0;
+	ETextureSourceFormat TextureFormat = TSF_Invalid;
+	if (NumSlices > 0 && GetSourceTexturesLayout(SizeX, SizeY, TextureFormat))
+	{
+		const int32 OneTextureSize = Source2DTextures[0]->Source.CalcMipSize(0);
+
+		TArray<FGuid> NewSliceIds;
+		NewSliceIds.Reserve(NumSlices);
 		for (UTexture2D* TextureSlice : Source2DTextures)
 		{
-			if (!TextureSlice)
-			{
-				bSourceTexturesAreValid = false;
-				break;
-			}
+			NewSliceIds.Add(TextureSlice->Source.GetId());
+		}
+
+		// The existing source can be patched in place as long as its layout did not change.
+		const bool bSourceLayoutMatches = CanPatchSource(SizeX, SizeY, TextureFormat);
+
+		if (bSourceLayoutMatches && AreSourceSlicesUpToDate())
+		{
+			// Nothing to rebuild, keep the current source and its GUID.
+			bSourceChanged = false;
+		}
+		else if (bSourceLayoutMatches)
+		{
+			UpdateChangedSourceSlices(NewSliceIds, OneTextureSize);
+		}
+		else
+		{
+			// Allocate the source without initial data, slices are then written straight into it.
+			Source.Init(SizeX, SizeY, NumSlices, 1, TextureFormat, nullptr);
 
-			FTextureSource& InitialSource = TextureSlice->Source;
-			int32 SliceSizeX = InitialSource.GetSizeX();
-			int32 SliceSizeY = InitialSource.GetSizeY();
-			int32 SliceNumMips = InitialSource.GetNumMips();
-			ETextureSourceFormat SliceFormat = InitialSource.GetFormat();
-
-			if (SizeX == -1)
-				SizeX = SliceSizeX;
-			if (SizeY == -1)
-				SizeY = SliceSizeY;
-			if (NumMips == -1)
-				NumMips = SliceNumMips;
-			if (TextureFormat == TSF_Invalid)
-				TextureFormat = SliceFormat;
-
-			if (SizeX != SliceSizeX ||
-				SizeY != SliceSizeY ||
-				NumMips != SliceNumMips ||
-				TextureFormat != SliceFormat)
+			TArray<int32> SliceIndices;
+			SliceIndices.Reserve(NumSlices);
+			for (int32 SliceIndex = 0; SliceIndex < NumSlices; ++SliceIndex)
 			{
-				bSourceTexturesAreValid = false;
-				break;
+				SliceIndices.Add(SliceIndex);
 			}
+
+			uint8* SourceData = (uint8*)Source.BulkData.Lock(LOCK_READ_WRITE);
+			ReadSliceSourceMips(SliceIndices, OneTextureSize, SourceData, NewSliceIds);
+			Source.BulkData.Unlock();
+			Source.ForceGenerateGuid();
+		}
+
+		SourceSliceIds = MoveTemp(NewSliceIds);
+		bSourceValid = true;
+	}
+
+	if (bSourceValid)
+	{
+		if (bSourceChanged)
+		{
+			SetLightingGuid(); // Because the content has changed, use a new GUID.
+		}
+	}
+	else
+	{
+		Source.Init(0, 0, 0, 0, TSF_Invalid, nullptr);
+		SourceSliceIds.Empty();
+	}
+
+	UpdateMipGenSettings();
+#endif // WITH_EDITOR
+
+	return bSourceValid;
+}
+
+#if WITH_EDITOR
+
+void UTexture2DArray::UpdateSourceFromSourceTexturesAsync()
+{
+	FTexture2DArrayBuilder::Get().Build(this);
+}
+
+bool UTexture2DArray::IsUpdatingSourceAsync() const
+{
+	return FTexture2DArrayBuilder::Get().IsBuilding(this);
+}
+
+bool UTexture2DArray::GetSourceTexturesLayout(int32& OutSizeX, int32& OutSizeY, ETextureSourceFormat& OutFormat) const
+{
+	if (Source2DTextures.Num() == 0 || !Source2DTextures[0])
+	{
+		return false;
+	}
+
+	const FTextureSource& FirstSource = Source2DTextures[0]->Source;
+	for (const UTexture2D* TextureSlice : Source2DTextures)
+	{
+		if (!TextureSlice ||
+			TextureSlice->Source.GetSizeX() != FirstSource.GetSizeX() ||
+			TextureSlice->Source.GetSizeY() != FirstSource.GetSizeY() ||
+			TextureSlice->Source.GetNumMips() != FirstSource.GetNumMips() ||
+			TextureSlice->Source.GetFormat() != FirstSource.GetFormat())
+		{
+			return false;
+		}
+	}
+
+	OutSizeX = FirstSource.GetSizeX();
+	OutSizeY = FirstSource.GetSizeY();
+	OutFormat = FirstSource.GetFormat();
+	return true;
+}
+
+bool UTexture2DArray::CanPatchSource(int32 SizeX, int32 SizeY, ETextureSourceFormat Format) const
+{
+	return Source.GetSizeX() == SizeX &&
+		Source.GetSizeY() == SizeY &&
+		Source.GetNumMips() == 1 &&
+		Source.GetFormat() == Format &&
+		Source.GetNumSlices() == SourceSliceIds.Num() &&
+		!Source.IsPNGCompressed() &&
+		!Source.HasHadBulkDataCleared() &&
+		HasSourcePayload();
+}
+
+bool UTexture2DArray::LoadReferencedSourceSlices()
+{
+	if (HasSourcePayload())
+	{
+		return true;
+	}
+
+	FTexture2DArrayBuilder::Get().Cancel(this);
+
+	const int32 NumSlices = Source.GetNumSlices();
+	if (NumSlices == 0 || NumSlices != Source2DTextures.Num() || NumSlices != SourceSliceIds.Num() || Source.GetNumMips() != 1)
+	{
+		UE_LOG(LogTexture, Warning, TEXT("Cannot read back the source of %s, its slice references do not match the source layout."), *GetPathName());
+		return false;
+	}
+
+	// The source GUID is kept below, a slice changed since the assembly would get its new pixels cached under the old derived data key.
+	if (!AreSourceSlicesUpToDate())
+	{
+		UE_LOG(LogTexture, Warning, TEXT("Cannot read back the source of %s, a slice texture is missing or changed since the source was assembled."), *GetPathName());
+		return false;
+	}
+
+	const int32 SourceSize = Source.CalcMipSize(0);
+	const int32 SliceSize = SourceSize / NumSlices;
+
+	TArray<int32> SliceIndices;
+	SliceIndices.Reserve(NumSlices);
+	for (int32 SliceIndex = 0; SliceIndex < NumSlices; ++SliceIndex)
+	{
+		SliceIndices.Add(SliceIndex);
+	}
+
+	// The source GUID is kept, the derived data key must not change by reading the slices back.
+	TArray<FGuid> SliceIds = SourceSliceIds;
+	Source.BulkData.Lock(LOCK_READ_WRITE);
+	uint8* SourceData = (uint8*)Source.BulkData.Realloc(SourceSize);
+	const bool bAllSlicesRead = ReadSliceSourceMips(SliceIndices, SliceSize, SourceData, SliceIds);
+
+	// A partially read source would be cached under the key of the complete one.
+	if (!bAllSlicesRead)
+	{
+		Source.BulkData.Realloc(0);
+		UE_LOG(LogTexture, Warning, TEXT("Cannot read back the source of %s, some of its slices failed to read."), *GetPathName());
+	}
+	Source.BulkData.Unlock();
+
+	return bAllSlicesRead;
+}
+
+bool UTexture2DArray::AreSourceSlicesUpToDate() const
+{
+	const int32 NumSlices = Source2DTextures.Num();
+	if (NumSlices == 0 || NumSlices != SourceSliceIds.Num() || NumSlices != Source.GetNumSlices())
+	{
+		return false;
+	}
+
+	for (int32 SliceIndex = 0; SliceIndex < NumSlices; ++SliceIndex)
+	{
+		const UTexture2D* TextureSlice = Source2DTextures[SliceIndex];
+		if (!TextureSlice ||
+			!SourceSliceIds[SliceIndex].IsValid() ||
+			TextureSlice->Source.GetId() != SourceSliceIds[SliceIndex] ||
+			TextureSlice->Source.GetSizeX() != Source.GetSizeX() ||
+			TextureSlice->Source.GetSizeY() != Source.GetSizeY() ||
+			TextureSlice->Source.GetFormat() != Source.GetFormat())
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void UTexture2DArray::UpdateChangedSourceSlices(TArray<FGuid>& NewSliceIds, int32 SliceSize)
+{
+	const int32 OldNumSlices = Source.GetNumSlices();
+	const int32 NewNumSlices = NewSliceIds.Num();
+	check(NewNumSlices == Source2DTextures.Num() && OldNumSlices == SourceSliceIds.Num());
+
+	// For every new slice find the old slice holding the same content, or INDEX_NONE if it has to be read from its texture.
+	TMap<FGuid, int32> OldSliceIndices;
+	for (int32 OldSliceIndex = 0; OldSliceIndex < OldNumSlices; ++OldSliceIndex)
+	{
+		if (SourceSliceIds[OldSliceIndex].IsValid() && !OldSliceIndices.Contains(SourceSliceIds[OldSliceIndex]))
+		{
+			OldSliceIndices.Add(SourceSliceIds[OldSliceIndex], OldSliceIndex);
+		}
+	}
+
+	TArray<int32> SliceOrigins;
+	SliceOrigins.Init(INDEX_NONE, NewNumSlices);
+	int32 NumMovedSlices = 0;
+	for (int32 SliceIndex = 0; SliceIndex < NewNumSlices; ++SliceIndex)
+	{
+		const FGuid& SliceId = NewSliceIds[SliceIndex];
+		if (!SliceId.IsValid())
+		{
+			continue;
+		}
+
+		if (SliceIndex < OldNumSlices && SourceSliceIds[SliceIndex] == SliceId)
+		{
+			SliceOrigins[SliceIndex] = SliceIndex;
+		}
+		else if (const int32* OldSliceIndex = OldSliceIndices.Find(SliceId))
+		{
+			SliceOrigins[SliceIndex] = *OldSliceIndex;
+			++NumMovedSlices;
+		}
+	}
+
+	uint8* SourceData = (uint8*)Source.BulkData.Lock(LOCK_READ_WRITE);
+
+	// Slices that only moved are saved aside first, their old location may be overwritten or truncated below.
+	TArray<uint8> MovedSlices;
+	MovedSlices.AddUninitialized(NumMovedSlices * SliceSize);
+	uint8* MovedPos = MovedSlices.GetData();
+	for (int32 SliceIndex = 0; SliceIndex < NewNumSlices; ++SliceIndex)
+	{
+		const int32 OldSliceIndex = SliceOrigins[SliceIndex];
+		if (OldSliceIndex != INDEX_NONE && OldSliceIndex != SliceIndex)
+		{
+			FMemory::Memcpy(MovedPos, SourceData + OldSliceIndex * SliceSize, SliceSize);
+			MovedPos += SliceSize;
 		}
+	}
+
+	// Realloc keeps the slices in front, only the tail gets allocated or dropped.
+	if (NewNumSlices != OldNumSlices)
+	{
+		SourceData = (uint8*)Source.BulkData.Realloc(NewNumSlices * SliceSize);
+	}
 
-		if (bSourceTexturesAreValid)
+	MovedPos = MovedSlices.GetData();
+	TArray<int32> SlicesToRead;
+	for (int32 SliceIndex = 0; SliceIndex < NewNumSlices; ++SliceIndex)
+	{
+		const int32 OldSliceIndex = SliceOrigins[SliceIndex];
+
+		if (OldSliceIndex == INDEX_NONE)
+		{
+			SlicesToRead.Add(SliceIndex);
+		}
+		else if (OldSliceIndex != SliceIndex)
 		{
-			const FPixelFormatInfo& InitialFormat = GPixelFormats[TextureFormat];
-			const int32 FormatDataSize = InitialFormat.BlockBytes;
-			const int32 OneTextureSize = SizeX * SizeY * FormatDataSize;
+			FMemory::Memcpy(SourceData + SliceIndex * SliceSize, MovedPos, SliceSize);
+			MovedPos += SliceSize;
+		}
+	}
 
+	ReadSliceSourceMips(SlicesToRead, SliceSize, SourceData, NewSliceIds);
+
+	Source.BulkData.Unlock();
+	Source.NumSlices = NewNumSlices;
+	Source.ForceGenerateGuid();
+}
 
-			uint8* TextureData = (uint8*)FMemory::Malloc(OneTextureSize * NumSlices);
-			uint8* CurPos = TextureData;
+bool UTexture2DArray::ReadSliceSourceMips(const TArray<int32>& SliceIndices, int32 SliceSize, uint8* SourceData, TArray<FGuid>& InOutSliceIds)
+{
+	if (SliceIndices.Num() == 0)
+	{
+		return true;
+	}
 
-			for (UTexture2D* TextureSlice : Source2DTextures)
+	// A texture used by several slices is read once, its source must not be read from several threads at the same time.
+	TArray<int32> UniqueSliceIndices;
+	TArray<int32> SliceUniqueIndices;
+	SliceUniqueIndices.Reserve(SliceIndices.Num());
+	{
+		TMap<const UTexture2D*, int32> TextureUniqueIndices;
+		for (int32 SliceIndex : SliceIndices)
+		{
+			const UTexture2D* TextureSlice = Source2DTextures[SliceIndex];
+			if (const int32* UniqueIndex = TextureUniqueIndices.Find(TextureSlice))
 			{
-				TArray<uint8> Ref2DData;
-				FTextureSource& InitialSource = TextureSlice->Source;
-				if (InitialSource.GetMipData(Ref2DData, 0))
-				{
-					FMemory::Memcpy(CurPos, Ref2DData.GetData(), OneTextureSize);
-				}
+				SliceUniqueIndices.Add(*UniqueIndex);
+			}
+			else
+			{
+				SliceUniqueIndices.Add(TextureUniqueIndices.Add(TextureSlice, UniqueSliceIndices.Add(SliceIndex)));
+			}
+		}
+	}
+	const int32 NumSlicesToRead = UniqueSliceIndices.Num();
+
+	// Loading bulk data from the package and loading modules are not thread safe, do both before going wide.
+	IImageWrapperModule* ImageWrapperModule = &FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+	for (int32 SliceIndex : UniqueSliceIndices)
+	{
+		FTextureSource& SliceSource = Source2DTextures[SliceIndex]->Source;
+		if (!SliceSource.IsBulkDataLoaded())
+		{
+			SliceSource.BulkData.Lock(LOCK_READ_ONLY);
+			SliceSource.BulkData.Unlock();
+		}
+	}
+
+	// Each task keeps pulling slices until none are left, reusing its scratch buffer across them.
+	FThreadSafeCounter NextSliceToRead;
+	FThreadSafeCounter NumSlicesRead;
+	FThreadSafeBool bCancelled;
+	TArray<bool> SlicesRead;
+	SlicesRead.AddZeroed(NumSlicesToRead);
+	TArray<bool> SlicesFailed;
+	SlicesFailed.AddZeroed(NumSlicesToRead);
 
-				CurPos += OneTextureSize;
+	auto ReadSlices = [&]()
+	{
+		TArray<uint8> ScratchData;
+		for (int32 ReadIndex = NextSliceToRead.Increment() - 1; ReadIndex < NumSlicesToRead && !bCancelled; ReadIndex = NextSliceToRead.Increment() - 1)
+		{
+			const int32 SliceIndex = UniqueSliceIndices[ReadIndex];
+			SlicesRead[ReadIndex] = ReadSliceSourceMip(Source2DTextures[SliceIndex]->Source, SliceSize, SourceData + SliceIndex * SliceSize, ScratchData, ImageWrapperModule);
+			if (!SlicesRead[ReadIndex])
+			{
+				SlicesFailed[ReadIndex] = true;
 			}
+			NumSlicesRead.Increment();
+		}
+	};
+
+	FScopedSlowTask SlowTask(NumSlicesToRead, FText::Format(LOCTEXT("ReadingSlices", "Reading {0} slices of {1}"), FText::AsNumber(NumSlicesToRead), FText::FromName(GetFName())));
+	SlowTask.MakeDialogDelayed(0.5f, /*bShowCancelButton=*/ true);
+
+	{
+		const int32 NumTasks = FMath::Min(NumSlicesToRead, FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+		TIndirectArray<FAsyncTask<FTexture2DArraySliceReadTask>> AsyncTasks;
+		for (int32 TaskIndex = 0; TaskIndex < NumTasks; ++TaskIndex)
+		{
+			FAsyncTask<FTexture2DArraySliceReadTask>* AsyncTask = new(AsyncTasks) FAsyncTask<FTexture2DArraySliceReadTask>(ReadSlices);
+			AsyncTask->StartBackgroundTask(GLargeThreadPool);
+		}
+
+		int32 NumSlicesReported = 0;
+		while (NumSlicesReported < NumSlicesToRead && !bCancelled)
+		{
+			FPlatformProcess::Sleep(0.01f);
 
+			const int32 NumSlicesDone = NumSlicesRead.GetValue();
+			SlowTask.EnterProgressFrame(NumSlicesDone - NumSlicesReported);
+			NumSlicesReported = NumSlicesDone;
 
-			Source.Init(SizeX, SizeY, NumSlices, 1, TextureFormat, TextureData);
-			bSourceValid = true;
+			if (SlowTask.ShouldCancel())
+			{
+				bCancelled = true;
+			}
+		}
 
-			FMemory::Free(TextureData);
+		for (FAsyncTask<FTexture2DArraySliceReadTask>& AsyncTask : AsyncTasks)
+		{
+			AsyncTask.EnsureCompletion();
 		}
 	}
 
-	if (bSourceValid)
+	// Other slices of the same texture get a copy of the one that was read.
+	// Slices that failed or were skipped by cancelling are left blank and forgotten, so they get read again on the next update.
+	int32 NumSlicesSkipped = 0;
+	for (int32 ReadIndex = 0; ReadIndex < SliceIndices.Num(); ++ReadIndex)
 	{
-		SetLightingGuid(); // Because the content has changed, use a new GUID.
+		const int32 SliceIndex = SliceIndices[ReadIndex];
+		const int32 UniqueIndex = SliceUniqueIndices[ReadIndex];
+		const int32 ReadSliceIndex = UniqueSliceIndices[UniqueIndex];
+		if (!SlicesRead[UniqueIndex])
+		{
+			FMemory::Memzero(SourceData + SliceIndex * SliceSize, SliceSize);
+			InOutSliceIds[SliceIndex].Invalidate();
+			++NumSlicesSkipped;
+		}
+		else if (ReadSliceIndex != SliceIndex)
+		{
+			FMemory::Memcpy(SourceData + SliceIndex * SliceSize, SourceData + ReadSliceIndex * SliceSize, SliceSize);
+		}
 	}
-	else
+
+	for (int32 ReadIndex = 0; ReadIndex < NumSlicesToRead; ++ReadIndex)
 	{
-		Source.Init(0, 0, 0, 0, TSF_Invalid, nullptr);
+		if (SlicesFailed[ReadIndex])
+		{
+			const int32 SliceIndex = UniqueSliceIndices[ReadIndex];
+			UE_LOG(LogTexture, Error, TEXT("Failed to read the source of %s for slice %d of %s, the slice is left blank."), *Source2DTextures[SliceIndex]->GetPathName(), SliceIndex, *GetPathName());
+		}
 	}
 
-	UpdateMipGenSettings();
-#endif // WITH_EDITOR
+	if (bCancelled)
+	{
+		UE_LOG(LogTexture, Warning, TEXT("Reading slices of %s was cancelled, %d slices are left blank."), *GetPathName(), NumSlicesSkipped);
+	}
 
-	return bSourceValid;
+	return NumSlicesSkipped == 0;
+}
+
+bool UTexture2DArray::ReadSliceSourceMip(FTextureSource& SliceSource, int32 SliceSize, uint8* OutSliceData, TArray<uint8>& ScratchData, IImageWrapperModule* ImageWrapperModule)
+{
+	bool bSuccess = false;
+
+	if (SliceSource.IsPNGCompressed())
+	{
+		// Decoding needs an intermediate buffer, the caller keeps it around so it is only allocated once.
+		if (SliceSource.GetMipData(ScratchData, 0, ImageWrapperModule) && ScratchData.Num() >= SliceSize)
+		{
+			FMemory::Memcpy(OutSliceData, ScratchData.GetData(), SliceSize);
+			bSuccess = true;
+		}
+	}
+	else if (SliceSource.BulkData.GetBulkDataSize() >= SliceSize)
+	{
+		// The top mip comes first in the bulk data, copy it directly.
+		const uint8* SliceSourceData = (const uint8*)SliceSource.BulkData.Lock(LOCK_READ_ONLY);
+		FMemory::Memcpy(OutSliceData, SliceSourceData, SliceSize);
+		SliceSource.BulkData.Unlock();
+		bSuccess = true;
+	}
+
+	if (!bSuccess)
+	{
+		FMemory::Memzero(OutSliceData, SliceSize);
+	}
+	return bSuccess;
 }
 
+#endif // WITH_EDITOR
+
 //~ Begin UObject Interface.
 
 void UTexture2DArray::Serialize(FArchive& Ar)
 {
 	DECLARE_SCOPE_CYCLE_COUNTER(TEXT("UTexture2DArray::Serialize"), STAT_Texture2DArray_Serialize, STATGROUP_LoadTime);
 
+#if WITH_EDITOR
+	// Reference only sources are saved without their pixels, they can be read back as long as the slices did not change.
+	void* SourcePayload = nullptr;
+	int32 SourcePayloadSize = 0;
+	if (bReferenceSliceSources && Ar.IsSaving() && Ar.IsPersistent() && !Ar.IsCooking() && AreSourceSlicesUpToDate() && HasSourcePayload())
+	{
+		SourcePayloadSize = Source.BulkData.GetBulkDataSize();
+		Source.BulkData.GetCopy(&SourcePayload, /*bDiscardInternalCopy=*/ false);
+		Source.BulkData.Lock(LOCK_READ_WRITE);
+		Source.BulkData.Realloc(0);
+		Source.BulkData.Unlock();
+	}
+#endif // WITH_EDITOR
+
 	Super::Serialize(Ar);
 
+#if WITH_EDITOR
+	if (SourcePayload)
+	{
+		Source.BulkData.Lock(LOCK_READ_WRITE);
+		FMemory::Memcpy(Source.BulkData.Realloc(SourcePayloadSize), SourcePayload, SourcePayloadSize);
+		Source.BulkData.Unlock();
+		FMemory::Free(SourcePayload);
+	}
+#endif // WITH_EDITOR
+
 	FStripDataFlags StripFlags(Ar);
 	bool bCooked = Ar.IsCooking();
 	Ar << bCooked;
@@ -136,7 +615,15 @@ void UTexture2DArray::PostLoad()
 #if WITH_EDITOR
 	FinishCachePlatformData();
 
-	UpdateSourceFromSourceTextures();
+	// Reassembling touches the bulk data of every slice, skip it when the slice sources did not change since the last save.
+	if (!AreSourceSlicesUpToDate())
+	{
+		UpdateSourceFromSourceTextures();
+	}
+	else
+	{
+		UpdateMipGenSettings();
+	}
 #endif // #if WITH_EDITOR
 
 	Super::PostLoad();
@@ -171,25 +658,96 @@ FString UTexture2DArray::GetDesc()
 		);
 }
 
-void UTexture2DArray::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
-{
-	Super::GetResourceSizeEx(CumulativeResourceSize);
-	CumulativeResourceSize.AddUnknownMemoryBytes(CalcTextureMemorySizeEnum(TMC_ResidentMips));
-}
-
 //~ End UObject Interface.
 
 //~ Begin UTexture Interface
 
+/** Sampler states shared by the texture 2D array resources, created on first use and released with the RHI. */
+class FTexture2DArraySamplerStateCache : public FRenderResource
+{
+public:
+	FSamplerStateRHIRef GetSamplerState(const FSamplerStateInitializerRHI& Initializer)
+	{
+		check(IsInRenderingThread());
+
+		const FSamplerKey Key(Initializer);
+		if (const FSamplerStateRHIRef* SamplerState = SamplerStates.Find(Key))
+		{
+			return *SamplerState;
+		}
+
+		FSamplerStateRHIRef SamplerState = RHICreateSamplerState(Initializer);
+		SamplerStates.Add(Key, SamplerState);
+		return SamplerState;
+	}
+
+	void ReleaseRHI() override
+	{
+		SamplerStates.Empty();
+	}
+
+private:
+	/** The initializer fields texture 2D arrays set. */
+	struct FSamplerKey
+	{
+		ESamplerFilter Filter;
+		ESamplerAddressMode AddressU;
+		ESamplerAddressMode AddressV;
+		float MipBias;
+
+		explicit FSamplerKey(const FSamplerStateInitializerRHI& Initializer)
+			: Filter(Initializer.Filter)
+			, AddressU(Initializer.AddressU)
+			, AddressV(Initializer.AddressV)
+			, MipBias(Initializer.MipBias)
+		{
+		}
+
+		bool operator==(const FSamplerKey& Other) const
+		{
+			return Filter == Other.Filter && AddressU == Other.AddressU && AddressV == Other.AddressV && MipBias == Other.MipBias;
+		}
+
+		friend uint32 GetTypeHash(const FSamplerKey& Key)
+		{
+			return HashCombine(GetTypeHash(((uint32)Key.Filter << 16) | ((uint32)Key.AddressU << 8) | (uint32)Key.AddressV), GetTypeHash(Key.MipBias));
+		}
+	};
+
+	TMap<FSamplerKey, FSamplerStateRHIRef> SamplerStates;
+};
+
+static TGlobalResource<FTexture2DArraySamplerStateCache> GTexture2DArraySamplerStateCache;
+
+/** Runtime data for a range of mips of a slice, see UTexture2DArray::UpdateSlice. */
+struct FTexture2DArraySliceUpdate
+{
+	int32 SliceIndex;
+	int32 FirstMip;
+	TArray<TArray<uint8>> MipData;
+};
+
+/**
+ * Mips of a texture 2D array as loaded, each mip holding every slice one after another.
+ * The mips can be merged as they get loaded into the layout RHICreateTexture2DArray takes as initial data,
+ * every mip of a slice one after another, so a texture is created with its data in a single call.
+ * Merging is a copy: the platform data keeps one bulk data per mip, and the RHI only takes initial data as a single
+ * slice major buffer. Each mip is freed once merged, so the peak is the merged data plus one mip.
+ */
 class FTexture2DArray2BulkData : public FResourceBulkDataInterface
 {
 public:
 	FTexture2DArray2BulkData(int32 InFirstMip, int32 InNumSlices)
-		: FirstMip(InFirstMip)
+		: MergedData(nullptr)
+		, MergedSize(0)
+		, MergedSliceSize(0)
+		, FirstMip(InFirstMip)
 		, NumSlices(InNumSlices)
 	{
 		FMemory::Memzero(MipData, sizeof(MipData));
 		FMemory::Memzero(MipSize, sizeof(MipSize));
+		FMemory::Memzero(MappedHandles, sizeof(MappedHandles));
+		FMemory::Memzero(MappedRegions, sizeof(MappedRegions));
 	}
 
 	~FTexture2DArray2BulkData()
@@ -199,181 +757,689 @@ public:
 
 	const void* GetResourceBulkData() const override
 	{
-		return MipData[FirstMip];
+		return MergedData;
 	}
 
 	uint32 GetResourceBulkDataSize() const override
 	{
-		return MipSize[FirstMip];
+		return MergedSize;
 	}
 
 	void Discard() override
 	{
 		for (int32 MipIndex = 0; MipIndex < MAX_TEXTURE_MIP_COUNT; ++MipIndex)
 		{
+			DiscardMip(MipIndex);
+		}
+		if (MergedData)
+		{
+			FMemory::Free(MergedData);
+			MergedData = nullptr;
+		}
+	}
+
+	/** Frees the data of a mip, its size is kept. */
+	void DiscardMip(int32 MipIndex)
+	{
+		if (MappedRegions[MipIndex])
+		{
+			delete MappedRegions[MipIndex];
+			delete MappedHandles[MipIndex];
+			MappedRegions[MipIndex] = nullptr;
+			MappedHandles[MipIndex] = nullptr;
+		}
+		else if (MipData[MipIndex])
+		{
+			FMemory::Free(MipData[MipIndex]);
+		}
+		MipData[MipIndex] = nullptr;
+	}
+
+	/**
+	 * Maps a mip straight from its bulk data file rather than reading it into a copy. The mapping is read only.
+	 * @return false if the mip is not stored uncompressed in a file of its own, or the platform can't map it.
+	 */
+	bool MapMip(int32 MipIndex, const FByteBulkData& BulkData)
+	{
+		if (!(BulkData.GetBulkDataFlags() & BULKDATA_PayloadInSeperateFile) || BulkData.IsStoredCompressedOnDisk() || BulkData.GetBulkDataOffsetInFile() < 0)
+		{
+			return false;
+		}
+
+		IMappedFileHandle* MappedHandle = FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*BulkData.GetFilename());
+		if (!MappedHandle)
+		{
+			return false;
+		}
+
+		IMappedFileRegion* MappedRegion = MappedHandle->MapRegion(BulkData.GetBulkDataOffsetInFile(), BulkData.GetBulkDataSize());
+		if (!MappedRegion)
+		{
+			delete MappedHandle;
+			return false;
+		}
+
+		DiscardMip(MipIndex);
+		MappedHandles[MipIndex] = MappedHandle;
+		MappedRegions[MipIndex] = MappedRegion;
+		MipData[MipIndex] = const_cast<uint8*>(MappedRegion->GetMappedPtr());
+		return true;
+	}
+
+	/** Allocates the merged data of the mips from FirstMip to NumMips, their sizes must be set. */
+	void BeginMerge(int32 NumMips)
+	{
+		check(!MergedData && NumMips <= MAX_TEXTURE_MIP_COUNT);
+
+		MergedSliceSize = 0;
+		for (int32 MipIndex = FirstMip; MipIndex < NumMips; ++MipIndex)
+		{
+			MergedSliceSize += MipSize[MipIndex] / NumSlices;
+		}
+		MergedSize = MergedSliceSize * NumSlices;
+		MergedData = (uint8*)FMemory::Malloc(MergedSize);
+	}
+
+	/** Where a mip of a slice is in the merged data. */
+	uint8* GetMergedMipSlice(int32 MipIndex, int32 SliceIndex)
+	{
+		check(MergedData && MipIndex >= FirstMip);
+
+		uint32 MipOffset = 0;
+		for (int32 PrevMipIndex = FirstMip; PrevMipIndex < MipIndex; ++PrevMipIndex)
+		{
+			MipOffset += MipSize[PrevMipIndex] / NumSlices;
+		}
+		return MergedData + SliceIndex * MergedSliceSize + MipOffset;
+	}
+
+	/** Copies each slice of a mip to its place in the merged data and frees the mip, a mip that is not loaded is left black. */
+	void MergeMip(int32 MipIndex)
+	{
+		const uint32 MipSliceSize = MipSize[MipIndex] / NumSlices;
+		for (int32 SliceIndex = 0; SliceIndex < NumSlices; ++SliceIndex)
+		{
+			uint8* Dest = GetMergedMipSlice(MipIndex, SliceIndex);
 			if (MipData[MipIndex])
 			{
-				FMemory::Free(MipData[MipIndex]);
-				MipData[MipIndex] = nullptr;
+				FMemory::Memcpy(Dest, (const uint8*)MipData[MipIndex] + SliceIndex * MipSliceSize, MipSliceSize);
+			}
+			else
+			{
+				FMemory::Memzero(Dest, MipSliceSize);
 			}
-			MipSize[MipIndex] = 0;
+		}
+
+		DiscardMip(MipIndex);
+	}
+
+	/** Merges the mips from FirstMip to NumMips that are already loaded. */
+	void MergeMips(int32 NumMips)
+	{
+		BeginMerge(NumMips);
+		for (int32 MipIndex = FirstMip; MipIndex < NumMips; ++MipIndex)
+		{
+			MergeMip(MipIndex);
 		}
 	}
 
+	bool IsMerged() const { return MergedData != nullptr; }
+
 	void** GetMipData() { return MipData; }
 	uint32* GetMipSize() { return MipSize; }
 	int32 GetFirstMip() const { return FirstMip; }
 
-	void MergeMips(int32 NumMips)
+protected:
+
+	void* MipData[MAX_TEXTURE_MIP_COUNT];
+	uint32 MipSize[MAX_TEXTURE_MIP_COUNT];
+	/** File mappings of the mapped mips. */
+	IMappedFileHandle* MappedHandles[MAX_TEXTURE_MIP_COUNT];
+	IMappedFileRegion* MappedRegions[MAX_TEXTURE_MIP_COUNT];
+	/** Merged mips, the slices one after another. */
+	uint8* MergedData;
+	uint32 MergedSize;
+	uint32 MergedSliceSize;
+	int32 FirstMip;
+	int32 NumSlices;
+};
+
+class FTexture2DArray2Resource : public FTextureResource
+{
+public:
+	FTexture2DArray2Resource(UTexture2DArray* InTexture2DArray, int32 MipBias)
+		: SizeX(InTexture2DArray->GetSizeX())
+		, SizeY(InTexture2DArray->GetSizeY())
+		, SizeZ(InTexture2DArray->GetSizeZ())
+		, CurrentFirstMip(INDEX_NONE)
+		, NumMips(InTexture2DArray->GetNumMips())
+		, PixelFormat(InTexture2DArray->GetPixelFormat())
+		, TextureSize(0)
+		, ResidentMipsStat(0)
+		, TextureReference(&InTexture2DArray->TextureReference)
+		, InitialData(MipBias, InTexture2DArray->GetSizeZ())
+		, PendingMipData(nullptr)
+		, PendingMipIndex(0)
+		, PendingSliceIndex(0)
+		, bPendingFromCurrent(false)
+		, bUploadPending(false)
+		, RenderThreadCycles(0)
 	{
-		check(NumMips < MAX_TEXTURE_MIP_COUNT);
+		check(0 < NumMips && NumMips <= MAX_TEXTURE_MIP_COUNT);
+		check(0 <= MipBias && MipBias < NumMips);
 
-		uint64 MergedSize = 0;
-		for (int32 MipIndex = FirstMip; MipIndex < NumMips; ++MipIndex)
+		STAT(LODGroupStatName = TextureGroupStatFNames[InTexture2DArray->LODGroup]);
+		TextureName = InTexture2DArray->GetFName();
+
+		CreationFlags = (InTexture2DArray->SRGB ? TexCreate_SRGB : 0) | TexCreate_OfflineProcessed | TexCreate_ShaderResource | (InTexture2DArray->bNoTiling ? TexCreate_NoTiling : 0);
+		SamplerFilter = (ESamplerFilter)UDeviceProfileManager::Get().GetActiveProfile()->GetTextureLODSettings()->GetSamplerFilter(InTexture2DArray);
+		AddressU = InTexture2DArray->AddressX == TA_Wrap ? AM_Wrap : (InTexture2DArray->AddressX == TA_Clamp ? AM_Clamp : AM_Mirror);
+		AddressV = InTexture2DArray->AddressY == TA_Wrap ? AM_Wrap : (InTexture2DArray->AddressY == TA_Clamp ? AM_Clamp : AM_Mirror);
+
+		bGreyScaleFormat = (PixelFormat == PF_G8) || (PixelFormat == PF_BC4);
+
+		// The placeholder only gets the mips already in memory, the others are left black until the streaming manager loads them.
+		FTexturePlatformData* PlatformData = InTexture2DArray->PlatformData;
+		check(PlatformData);
+		SetMipSizes(*PlatformData, InitialData);
+		for (int32 MipIndex = MipBias; MipIndex < NumMips; ++MipIndex)
+		{
+			FByteBulkData& BulkData = PlatformData->Mips[MipIndex].BulkData;
+			const int32 BulkDataSize = BulkData.GetBulkDataSize();
+			if (BulkDataSize > 0 && BulkData.IsBulkDataLoaded())
+			{
+				void* MipData = FMemory::Malloc(BulkDataSize);
+				FMemory::Memcpy(MipData, BulkData.LockReadOnly(), BulkDataSize);
+				BulkData.Unlock();
+				InitialData.GetMipData()[MipIndex] = MipData;
+			}
+		}
+	}
+
+	~FTexture2DArray2Resource()
+	{
+		delete PendingMipData;
+	}
+
+	void InitRHI() override
+	{
+		INC_DWORD_STAT(STAT_Texture2DArrayCount);
+		INC_DWORD_STAT_BY(STAT_Texture2DArraySlices, SizeZ);
+
+		{
+			SCOPE_CYCLE_COUNTER(STAT_Texture2DArrayRenderThreadUpload);
+			const uint32 StartCycles = FPlatformTime::Cycles();
+
+			const int32 FirstMip = InitialData.GetFirstMip();
+			InitialData.MergeMips(NumMips);
+			PatchSliceUpdates(InitialData);
+			FTexture2DArrayRHIRef NewTexture = CreateRHITexture(FirstMip, &InitialData);
+			InitialData.Discard();
+			SetCurrentTexture(NewTexture, FirstMip);
+
+			AddRenderThreadTime(StartCycles);
+		}
+
+		// Arrays with the same filter and addressing share their sampler state.
+		FSamplerStateInitializerRHI SamplerStateInitializer
+		(
+			SamplerFilter,
+			AddressU,
+			AddressV,
+			AM_Clamp,
+			UTexture2D::GetGlobalMipMapLODBias()
+		);
+		SamplerStateRHI = GTexture2DArraySamplerStateCache.GetSamplerState(SamplerStateInitializer);
+	}
+
+	void ReleaseRHI() override
+	{
+		DEC_DWORD_STAT(STAT_Texture2DArrayCount);
+		DEC_DWORD_STAT_BY(STAT_Texture2DArraySlices, SizeZ);
+		SetTextureStats(0, 0);
+		if (TextureReference)
+		{
+			RHIUpdateTextureReference(TextureReference->TextureReferenceRHI, FTextureRHIParamRef());
+		}
+		Texture2DArrayRHI.SafeRelease();
+		CancelPendingUpload();
+		bUploadPending = false;
+		FTextureResource::ReleaseRHI();
+	}
+
+	/**
+	 * Starts switching to a new RHI texture made of the mips loaded by a streaming request, takes ownership of MipData.
+	 * Merged mips are swapped in right away, created with the texture. Otherwise the upload is spread over the next frames
+	 * by ContinuePendingUpload and the current texture is used meanwhile.
+	 */
+	void UpdateMips(FTexture2DArray2BulkData* MipData)
+	{
+		check(IsInRenderingThread());
+
+		CancelPendingUpload();
+		if (!IsInitialized())
+		{
+			delete MipData;
+			bUploadPending = false;
+			return;
+		}
+
+		if (MipData->IsMerged())
+		{
+			SCOPE_CYCLE_COUNTER(STAT_Texture2DArrayRenderThreadUpload);
+			const uint32 StartCycles = FPlatformTime::Cycles();
+			PatchSliceUpdates(*MipData);
+			FTexture2DArrayRHIRef NewTexture = CreateRHITexture(MipData->GetFirstMip(), MipData);
+			SetCurrentTexture(NewTexture, MipData->GetFirstMip());
+			delete MipData;
+			bUploadPending = false;
+			AddRenderThreadTime(StartCycles);
+			return;
+		}
+
+		PendingMipData = MipData;
+		PendingMipIndex = MipData->GetFirstMip();
+		PendingSliceIndex = 0;
+		{
+			SCOPE_CYCLE_COUNTER(STAT_Texture2DArrayRenderThreadUpload);
+			const uint32 StartCycles = FPlatformTime::Cycles();
+			PendingTexture2DArrayRHI = CreateRHITexture(MipData->GetFirstMip());
+			AddRenderThreadTime(StartCycles);
+		}
+
+		ContinuePendingUpload();
+	}
+
+	/**
+	 * Starts switching to a new RHI texture without the mips before NewFirstMip. The mips it keeps are copied
+	 * from the current texture, over the next frames like the uploads of UpdateMips, instead of being loaded again.
+	 */
+	void DropMips(int32 NewFirstMip)
+	{
+		check(IsInRenderingThread());
+
+		CancelPendingUpload();
+		if (!IsInitialized() || NewFirstMip <= CurrentFirstMip)
+		{
+			bUploadPending = false;
+			return;
+		}
+
+		PendingMipData = new FTexture2DArray2BulkData(NewFirstMip, SizeZ);
+		PendingMipIndex = NewFirstMip;
+		PendingSliceIndex = 0;
+		bPendingFromCurrent = true;
+		{
+			SCOPE_CYCLE_COUNTER(STAT_Texture2DArrayRenderThreadUpload);
+			const uint32 StartCycles = FPlatformTime::Cycles();
+			PendingTexture2DArrayRHI = CreateRHITexture(NewFirstMip);
+			AddRenderThreadTime(StartCycles);
+		}
+
+		ContinuePendingUpload();
+	}
+
+	/** Uploads the next subresources of the pending texture within the frame budget, swaps it in once complete. */
+	void ContinuePendingUpload()
+	{
+		check(IsInRenderingThread());
+
+		if (!PendingMipData)
+		{
+			return;
+		}
+
+		SCOPE_CYCLE_COUNTER(STAT_Texture2DArrayRenderThreadUpload);
+		const uint32 StartCycles = FPlatformTime::Cycles();
+
+		const int32 PendingFirstMip = PendingMipData->GetFirstMip();
+		const int64 BudgetBytes = (int64)CVarTexture2DArrayUploadBudget.GetValueOnRenderThread() * 1024;
+		int64 UploadedBytes = 0;
+		while (PendingMipIndex < NumMips && (BudgetBytes <= 0 || UploadedBytes < BudgetBytes))
+		{
+			UploadedBytes += bPendingFromCurrent
+				? CopyResidentMipSlice(PendingFirstMip, PendingMipIndex, PendingSliceIndex)
+				: UploadMipSlice(PendingTexture2DArrayRHI, PendingFirstMip, *PendingMipData, PendingMipIndex, PendingSliceIndex);
+			if (++PendingSliceIndex == (int32)SizeZ)
+			{
+				PendingMipData->DiscardMip(PendingMipIndex);
+				PendingSliceIndex = 0;
+				++PendingMipIndex;
+			}
+		}
+
+		if (PendingMipIndex == NumMips)
+		{
+			SetCurrentTexture(PendingTexture2DArrayRHI, PendingFirstMip);
+			CancelPendingUpload();
+			bUploadPending = false;
+		}
+
+		AddRenderThreadTime(StartCycles);
+	}
+
+	/**
+	 * Stores runtime slice updates and copies them into the current RHI texture, and into the part of the pending one already uploaded.
+	 * Mips that are not resident are skipped, the stored data is written again to every texture swapped in later.
+	 * Each updated subresource is locked once, whatever the number of updates it got.
+	 */
+	void ApplySliceUpdates(TArray<FTexture2DArraySliceUpdate>& Updates)
+	{
+		check(IsInRenderingThread());
+
+		TArray<uint32> UpdatedKeys;
+		for (FTexture2DArraySliceUpdate& Update : Updates)
+		{
+			for (int32 MipOffset = 0; MipOffset < Update.MipData.Num(); ++MipOffset)
+			{
+				const uint32 Key = GetSliceMipKey(Update.SliceIndex, Update.FirstMip + MipOffset);
+				SliceMipUpdates.Add(Key, MoveTemp(Update.MipData[MipOffset]));
+				UpdatedKeys.AddUnique(Key);
+			}
+		}
+
+		if (!IsInitialized())
+		{
+			return;
+		}
+
+		SCOPE_CYCLE_COUNTER(STAT_Texture2DArrayRenderThreadUpload);
+		const uint32 StartCycles = FPlatformTime::Cycles();
+
+		for (uint32 Key : UpdatedKeys)
+		{
+			const int32 SliceIndex = Key >> 8;
+			const int32 MipIndex = Key & 0xff;
+			const uint8* SrcData = SliceMipUpdates.FindChecked(Key).GetData();
+			if (MipIndex >= CurrentFirstMip)
+			{
+				CopyMipSlice(Texture2DArrayRHI, CurrentFirstMip, MipIndex, SliceIndex, SrcData);
+			}
+
+			// The subresources of the pending texture not uploaded yet get the update once they are.
+			if (PendingMipData && MipIndex >= PendingMipData->GetFirstMip() && (MipIndex < PendingMipIndex || (MipIndex == PendingMipIndex && SliceIndex < PendingSliceIndex)))
+			{
+				CopyMipSlice(PendingTexture2DArrayRHI, PendingMipData->GetFirstMip(), MipIndex, SliceIndex, SrcData);
+			}
+		}
+
+		AddRenderThreadTime(StartCycles);
+	}
+
+	/** Whether a new texture is being uploaded. Safe to call from the game thread. */
+	bool IsUploadPending() const
+	{
+		return bUploadPending;
+	}
+
+	/** Marks an upload as pending from the game thread, before the render command starting it is enqueued. */
+	void MarkUploadPending()
+	{
+		bUploadPending = true;
+	}
+
+	/** Render thread time spent creating and uploading the RHI textures of this array, in milliseconds. */
+	float GetRenderThreadTimeMs() const
+	{
+		return FPlatformTime::ToMilliseconds(RenderThreadCycles);
+	}
+
+	/**
+	 * Loads the mips of a streaming request, from the first mip of MipData on. Called off the game thread.
+	 * Every mip is read again from its bulk data or the DDC, no copy of the resident mips is kept around.
+	 * Only requests adding mips load them, the ones dropping mips keep the resident ones with DropMips.
+	 * @param PlatformData - Platform data of the texture.
+	 * @param MipData - Receives the loaded mips.
+	 * @param bMerge - Whether to merge each mip as soon as it is loaded, for the texture to be created with them.
+	 * @return false if some of the mips could not be loaded.
+	 */
+	bool LoadStreamedMips(FTexturePlatformData& PlatformData, FTexture2DArray2BulkData& MipData, bool bMerge) const
+	{
+		SetMipSizes(PlatformData, MipData);
+		if (bMerge)
+		{
+			MipData.BeginMerge(NumMips);
+		}
+
+		for (int32 MipIndex = MipData.GetFirstMip(); MipIndex < NumMips; ++MipIndex)
+		{
+			if (!LoadStreamedMip(PlatformData.Mips[MipIndex], MipData, MipIndex))
+			{
+				MipData.Discard();
+				return false;
+			}
+			if (bMerge)
+			{
+				MipData.MergeMip(MipIndex);
+			}
+		}
+		return true;
+	}
+
+	uint32 GetSizeX() const override
+	{
+		return FMath::Max<uint32>(SizeX >> CurrentFirstMip, 1);
+	}
+
+	uint32 GetSizeY() const override
+	{
+		return FMath::Max<uint32>(SizeY >> CurrentFirstMip, 1);
+	}
+
+private:
+
+	static void SetMipSizes(const FTexturePlatformData& PlatformData, FTexture2DArray2BulkData& MipData)
+	{
+		for (int32 MipIndex = MipData.GetFirstMip(); MipIndex < PlatformData.Mips.Num(); ++MipIndex)
+		{
+			const FTexture2DMipMap& MipMap = PlatformData.Mips[MipIndex];
+
+			// The bulk data can be bigger because of memory alignment constraints on each slice and mips.
+			MipData.GetMipSize()[MipIndex] = FMath::Max<int32>(
+				MipMap.BulkData.GetBulkDataSize(),
+				CalcTextureMipMapSize(PlatformData.SizeX, PlatformData.SizeY, PlatformData.PixelFormat, MipIndex) * PlatformData.NumSlices
+				);
+		}
+	}
+
+	/**
+	 * Loads a single streamed mip, from the DDC in the editor when it is not inlined, from its bulk data otherwise.
+	 * Mips of cooked arrays are memory mapped when possible.
+	 */
+	static bool LoadStreamedMip(FTexture2DMipMap& MipMap, FTexture2DArray2BulkData& MipData, int32 MipIndex)
+	{
+		void*& OutMipData = MipData.GetMipData()[MipIndex];
+
+#if WITH_EDITOR
+		if (!MipMap.DerivedDataKey.IsEmpty())
+		{
+			TArray<uint8> DerivedData;
+			if (!GetDerivedDataCacheRef().GetSynchronous(*MipMap.DerivedDataKey, DerivedData))
+			{
+				return false;
+			}
+
+			int32 MipSize = 0;
+			FMemoryReader Ar(DerivedData, /*bIsPersistent=*/ true);
+			Ar << MipSize;
+			OutMipData = FMemory::Malloc(MipSize);
+			Ar.Serialize(OutMipData, MipSize);
+			return true;
+		}
+#endif // WITH_EDITOR
+
+		if (MipMap.BulkData.GetBulkDataSize() > 0)
 		{
-			MergedSize += MipSize[MipIndex];
+			if (CVarTexture2DArrayMapStreamedMips.GetValueOnAnyThread() != 0 && MipData.MapMip(MipIndex, MipMap.BulkData))
+			{
+				return true;
+			}
+
+			OutMipData = nullptr;
+			MipMap.BulkData.GetCopy(&OutMipData, /*bDiscardInternalCopy=*/ false);
+			return OutMipData != nullptr;
+		}
+		return false;
+	}
+
+	/**
+	 * Copies a mip of a slice from MipData into an RHI texture.
+	 * @param Texture - The RHI texture to copy to.
+	 * @param TextureFirstMip - Index in the full mip chain of the first mip of Texture.
+	 * @param MipData - Loaded mips, the slices of a mip stored one after another.
+	 * @param MipIndex - Index of the mip in the full mip chain.
+	 * @param SliceIndex - Index of the slice.
+	 * @return the number of bytes copied.
+	 */
+	uint32 UploadMipSlice(FTexture2DArrayRHIParamRef Texture, int32 TextureFirstMip, FTexture2DArray2BulkData& MipData, int32 MipIndex, int32 SliceIndex)
+	{
+		if (const TArray<uint8>* SliceMipUpdate = SliceMipUpdates.Find(GetSliceMipKey(SliceIndex, MipIndex)))
+		{
+			return CopyMipSlice(Texture, TextureFirstMip, MipIndex, SliceIndex, SliceMipUpdate->GetData());
+		}
+
+		const uint8* SrcMipData = (const uint8*)MipData.GetMipData()[MipIndex];
+		if (!SrcMipData)
+		{
+			return 0;
 		}
 
-		// Don't do anything if there is nothing to merge
-		if (MergedSize > MipSize[FirstMip])
+		return CopyMipSlice(Texture, TextureFirstMip, MipIndex, SliceIndex, SrcMipData + SliceIndex * (MipData.GetMipSize()[MipIndex] / SizeZ));
+	}
+
+	/**
+	 * Copies a mip of a slice from the current texture into the pending one. Slice updates are already in the current texture.
+	 * @return the number of bytes copied.
+	 */
+	uint32 CopyResidentMipSlice(int32 PendingFirstMip, int32 MipIndex, int32 SliceIndex)
+	{
+		uint32 SrcStride = 0;
+		const uint8* SrcData = (const uint8*)RHILockTexture2DArray(Texture2DArrayRHI, SliceIndex, MipIndex - CurrentFirstMip, RLM_ReadOnly, SrcStride, false);
+		const uint32 CopiedBytes = CopyMipSlice(PendingTexture2DArrayRHI, PendingFirstMip, MipIndex, SliceIndex, SrcData, SrcStride);
+		RHIUnlockTexture2DArray(Texture2DArrayRHI, SliceIndex, MipIndex - CurrentFirstMip, false);
+		return CopiedBytes;
+	}
+
+	/** Writes the stored slice updates over merged mips, before a texture is created with them. */
+	void PatchSliceUpdates(FTexture2DArray2BulkData& MipData)
+	{
+		for (const TPair<uint32, TArray<uint8>>& SliceMipUpdate : SliceMipUpdates)
 		{
-			uint8* MergedAlloc = (uint8*)FMemory::Malloc(MergedSize);
-			uint8* CurrPos = MergedAlloc;
-			for (int32 TextureSlice = 0; TextureSlice < NumSlices; ++TextureSlice)
+			const int32 SliceIndex = SliceMipUpdate.Key >> 8;
+			const int32 MipIndex = SliceMipUpdate.Key & 0xff;
+			if (MipIndex >= MipData.GetFirstMip())
 			{
-				for (int32 MipIndex = FirstMip; MipIndex < NumMips; ++MipIndex)
-				{
-					int32 MipSliceSize = MipSize[MipIndex] / NumSlices;
-					int32 SliceOffset = TextureSlice * MipSliceSize;
-					if (MipData[MipIndex])
-					{
-						FMemory::Memcpy(CurrPos, (uint8*)MipData[MipIndex] + SliceOffset, MipSliceSize);
-					}
-					CurrPos += MipSliceSize;
-				}
+				FMemory::Memcpy(MipData.GetMergedMipSlice(MipIndex, SliceIndex), SliceMipUpdate.Value.GetData(), SliceMipUpdate.Value.Num());
 			}
-
-			Discard();
-
-			MipData[FirstMip] = MergedAlloc;
-			MipSize[FirstMip] = MergedSize;
 		}
 	}
 
-protected:
-
-	void* MipData[MAX_TEXTURE_MIP_COUNT];
-	uint32 MipSize[MAX_TEXTURE_MIP_COUNT];
-	int32 FirstMip;
-	int32 NumSlices;
-};
-
-class FTexture2DArray2Resource : public FTextureResource
-{
-public:
-	FTexture2DArray2Resource(UTexture2DArray* InTexture2DArray, int32 MipBias)
-		: SizeX(InTexture2DArray->GetSizeX())
-		, SizeY(InTexture2DArray->GetSizeY())
-		, SizeZ(InTexture2DArray->GetSizeZ())
-		, CurrentFirstMip(INDEX_NONE)
-		, NumMips(InTexture2DArray->GetNumMips())
-		, PixelFormat(InTexture2DArray->GetPixelFormat())
-		, TextureSize(0)
-		, TextureReference(&InTexture2DArray->TextureReference)
-		, InitialData(MipBias, InTexture2DArray->GetSizeZ())
+	/** Key of a mip of a slice in SliceMipUpdates. */
+	static uint32 GetSliceMipKey(int32 SliceIndex, int32 MipIndex)
 	{
-		check(0 < NumMips && NumMips <= MAX_TEXTURE_MIP_COUNT);
-		check(0 <= MipBias && MipBias < NumMips);
-
-		STAT(LODGroupStatName = TextureGroupStatFNames[InTexture2DArray->LODGroup]);
-		TextureName = InTexture2DArray->GetFName();
-
-		CreationFlags = (InTexture2DArray->SRGB ? TexCreate_SRGB : 0) | TexCreate_OfflineProcessed | TexCreate_ShaderResource | (InTexture2DArray->bNoTiling ? TexCreate_NoTiling : 0);
-		SamplerFilter = (ESamplerFilter)UDeviceProfileManager::Get().GetActiveProfile()->GetTextureLODSettings()->GetSamplerFilter(InTexture2DArray);
+		return ((uint32)SliceIndex << 8) | (uint32)MipIndex;
+	}
 
-		bGreyScaleFormat = (PixelFormat == PF_G8) || (PixelFormat == PF_BC4);
+	/**
+	 * Copies a mip of a slice into an RHI texture, locking it through the immediate command list.
+	 * @param SrcData - The mip data, as rows of blocks.
+	 * @param SrcStride - Bytes between two rows of blocks in SrcData, 0 if they are tightly packed.
+	 * @return the number of bytes copied.
+	 */
+	uint32 CopyMipSlice(FTexture2DArrayRHIParamRef Texture, int32 TextureFirstMip, int32 MipIndex, int32 SliceIndex, const uint8* SrcData, uint32 SrcStride = 0)
+	{
+		const FPixelFormatInfo& FormatInfo = GPixelFormats[PixelFormat];
+		const uint32 NumBlocksX = FMath::DivideAndRoundUp<uint32>(FMath::Max<uint32>(SizeX >> MipIndex, 1), FormatInfo.BlockSizeX);
+		const uint32 NumBlocksY = FMath::DivideAndRoundUp<uint32>(FMath::Max<uint32>(SizeY >> MipIndex, 1), FormatInfo.BlockSizeY);
+		const uint32 RowSize = NumBlocksX * FormatInfo.BlockBytes;
+		if (SrcStride == 0)
+		{
+			SrcStride = RowSize;
+		}
 
-		FTexturePlatformData* PlatformData = InTexture2DArray->PlatformData;
-		if (PlatformData && PlatformData->TryLoadMips(MipBias, InitialData.GetMipData() + MipBias))
+		uint32 DestStride = 0;
+		uint8* DestData = (uint8*)RHILockTexture2DArray(Texture, SliceIndex, MipIndex - TextureFirstMip, RLM_WriteOnly, DestStride, false);
+		if (DestStride == RowSize && SrcStride == RowSize)
+		{
+			FMemory::Memcpy(DestData, SrcData, RowSize * NumBlocksY);
+		}
+		else
 		{
-			for (int32 MipIndex = MipBias; MipIndex < NumMips; ++MipIndex)
+			for (uint32 BlockY = 0; BlockY < NumBlocksY; ++BlockY)
 			{
-				const FTexture2DMipMap& MipMap = PlatformData->Mips[MipIndex];
-
-				// The bulk data can be bigger because of memory alignment constraints on each slice and mips.
-				InitialData.GetMipSize()[MipIndex] = FMath::Max<int32>(
-					MipMap.BulkData.GetBulkDataSize(),
-					CalcTextureMipMapSize(SizeX, SizeY, (EPixelFormat)PixelFormat, MipIndex) * SizeZ
-					);
+				FMemory::Memcpy(DestData + BlockY * DestStride, SrcData + BlockY * SrcStride, RowSize);
 			}
 		}
-	}
+		RHIUnlockTexture2DArray(Texture, SliceIndex, MipIndex - TextureFirstMip, false);
 
-	~FTexture2DArray2Resource() {}
+		return RowSize * NumBlocksY;
+	}
 
-	void InitRHI() override
+	/**
+	 * Creates an RHI texture holding the mips from FirstMip on.
+	 * @param InitialData - Merged mips to create the texture with, the mips are copied with UploadMipSlice if null.
+	 */
+	FTexture2DArrayRHIRef CreateRHITexture(int32 FirstMip, FResourceBulkDataInterface* InitialData = nullptr)
 	{
-		INC_DWORD_STAT_BY(STAT_TextureMemory, TextureSize);
-		INC_DWORD_STAT_FNAME_BY(LODGroupStatName, TextureSize);
+		FRHIResourceCreateInfo CreateInfo;
+		CreateInfo.BulkData = InitialData;
 
-		CurrentFirstMip = InitialData.GetFirstMip();
-
-		// Create the RHI texture.
-		{
-			FRHIResourceCreateInfo CreateInfo;
-			InitialData.MergeMips(NumMips);
-			CreateInfo.BulkData = &InitialData;
+		const uint32 BaseMipSizeX = FMath::Max<uint32>(SizeX >> FirstMip, 1);
+		const uint32 BaseMipSizeY = FMath::Max<uint32>(SizeY >> FirstMip, 1);
 
-			const uint32 BaseMipSizeX = FMath::Max<uint32>(SizeX >> CurrentFirstMip, 1);
-			const uint32 BaseMipSizeY = FMath::Max<uint32>(SizeY >> CurrentFirstMip, 1);
+		FTexture2DArrayRHIRef NewTexture = RHICreateTexture2DArray(BaseMipSizeX, BaseMipSizeY, SizeZ, PixelFormat, NumMips - FirstMip, CreationFlags, CreateInfo);
+		NewTexture->SetName(TextureName);
+		RHIBindDebugLabelName(NewTexture, *TextureName.ToString());
+		return NewTexture;
+	}
 
-			Texture2DArrayRHI = RHICreateTexture2DArray(BaseMipSizeX, BaseMipSizeY, SizeZ, PixelFormat, NumMips - CurrentFirstMip, CreationFlags, CreateInfo);
-			TextureRHI = Texture2DArrayRHI;
-		}
+	/** Makes NewTexture the texture of the resource and points the texture reference to it. */
+	void SetCurrentTexture(FTexture2DArrayRHIParamRef NewTexture, int32 FirstMip)
+	{
+		CurrentFirstMip = FirstMip;
+		Texture2DArrayRHI = NewTexture;
+		TextureRHI = Texture2DArrayRHI;
 
-		TextureRHI->SetName(TextureName);
-		RHIBindDebugLabelName(TextureRHI, *TextureName.ToString());
+		const uint32 NewTextureSize = CalcTexture2DArrayPlatformSize(FMath::Max<uint32>(SizeX >> FirstMip, 1), FMath::Max<uint32>(SizeY >> FirstMip, 1), SizeZ, (EPixelFormat)PixelFormat, NumMips - FirstMip, CreationFlags);
+		SetTextureStats(NewTextureSize, NumMips - FirstMip);
 
 		if (TextureReference)
 		{
 			RHIUpdateTextureReference(TextureReference->TextureReferenceRHI, TextureRHI);
 		}
-
-		// Create the sampler state RHI resource.
-		FSamplerStateInitializerRHI SamplerStateInitializer
-		(
-			SamplerFilter,
-			AM_Clamp,
-			AM_Clamp,
-			AM_Clamp
-		);
-		SamplerStateRHI = RHICreateSamplerState(SamplerStateInitializer);
 	}
 
-	void ReleaseRHI() override
+	/** Replaces the size and mip count of the current texture in the texture memory stats. */
+	void SetTextureStats(int32 NewTextureSize, int32 NewResidentMips)
 	{
 		DEC_DWORD_STAT_BY(STAT_TextureMemory, TextureSize);
 		DEC_DWORD_STAT_FNAME_BY(LODGroupStatName, TextureSize);
-		if (TextureReference)
-		{
-			RHIUpdateTextureReference(TextureReference->TextureReferenceRHI, FTextureRHIParamRef());
-		}
-		Texture2DArrayRHI.SafeRelease();
-		FTextureResource::ReleaseRHI();
+		DEC_MEMORY_STAT_BY(STAT_Texture2DArrayMemory, TextureSize);
+		DEC_DWORD_STAT_BY(STAT_Texture2DArrayResidentMips, ResidentMipsStat);
+
+		TextureSize = NewTextureSize;
+		ResidentMipsStat = NewResidentMips;
+
+		INC_DWORD_STAT_BY(STAT_TextureMemory, TextureSize);
+		INC_DWORD_STAT_FNAME_BY(LODGroupStatName, TextureSize);
+		INC_MEMORY_STAT_BY(STAT_Texture2DArrayMemory, TextureSize);
+		INC_DWORD_STAT_BY(STAT_Texture2DArrayResidentMips, ResidentMipsStat);
 	}
 
-	uint32 GetSizeX() const override
+	/** Drops the texture being uploaded, if any. bUploadPending is left to the caller. */
+	void CancelPendingUpload()
 	{
-		return FMath::Max<uint32>(SizeX >> CurrentFirstMip, 1);
+		PendingTexture2DArrayRHI.SafeRelease();
+		delete PendingMipData;
+		PendingMipData = nullptr;
+		bPendingFromCurrent = false;
 	}
 
-	uint32 GetSizeY() const override
+	void AddRenderThreadTime(uint32 StartCycles)
 	{
-		return FMath::Max<uint32>(SizeY >> CurrentFirstMip, 1);
+		RenderThreadCycles += FPlatformTime::Cycles() - StartCycles;
 	}
 
-private:
-
 #if STATS
 	/** The FName of the LODGroup-specific stat	*/
 	FName LODGroupStatName;
@@ -397,18 +1463,180 @@ private:
 	uint32 CreationFlags;
 	/** Cached texture size for stats. */
 	int32 TextureSize;
+	/** Resident mips of the current texture counted in the stats. */
+	int32 ResidentMipsStat;
 
 	/** The filtering to use for this texture */
 	ESamplerFilter SamplerFilter;
+	/** The addressing modes to use for this texture */
+	ESamplerAddressMode AddressU;
+	ESamplerAddressMode AddressV;
 
 	/** A reference to the texture's RHI resource as a texture 2D array. */
 	FTexture2DArrayRHIRef Texture2DArrayRHI;
 
 	FTextureReference* TextureReference;
 
+	/** Mips of the placeholder the texture is created with. */
 	FTexture2DArray2BulkData InitialData;
+
+	/** The texture being uploaded by a streaming request, swapped in once complete. */
+	FTexture2DArrayRHIRef PendingTexture2DArrayRHI;
+	/** Mips of the texture being uploaded, freed as they get uploaded. */
+	FTexture2DArray2BulkData* PendingMipData;
+	/** Next subresource of the pending texture to upload. */
+	int32 PendingMipIndex;
+	int32 PendingSliceIndex;
+	/** Whether the pending texture is copied from the current one, PendingMipData then holds no mips. */
+	bool bPendingFromCurrent;
+	/** Whether a texture is being uploaded, read by the game thread. */
+	FThreadSafeBool bUploadPending;
+
+	/** Render thread time spent on this array. */
+	uint32 RenderThreadCycles;
+
+	/** Data of the runtime slice updates by slice and mip, see GetSliceMipKey. Written to every new texture. */
+	TMap<uint32, TArray<uint8>> SliceMipUpdates;
+};
+
+/** Loads the mips of a streaming request on a worker thread. */
+class FTexture2DArrayMipLoadTask : public FNonAbandonableTask
+{
+public:
+	FTexture2DArrayMipLoadTask(const FTexture2DArray2Resource* InResource, FTexturePlatformData* InPlatformData, int32 FirstMip, bool bInMergeMips)
+		: Resource(InResource)
+		, PlatformData(InPlatformData)
+		, MipData(new FTexture2DArray2BulkData(FirstMip, InPlatformData->NumSlices))
+		, bMergeMips(bInMergeMips)
+		, bSucceeded(false)
+	{
+	}
+
+	void DoWork()
+	{
+		bSucceeded = Resource->LoadStreamedMips(*PlatformData, *MipData, bMergeMips);
+	}
+
+	FORCEINLINE TStatId GetStatId() const
+	{
+		RETURN_QUICK_DECLARE_CYCLE_STAT(FTexture2DArrayMipLoadTask, STATGROUP_ThreadPoolAsyncTasks);
+	}
+
+	const FTexture2DArray2Resource* Resource;
+	FTexturePlatformData* PlatformData;
+	TUniquePtr<FTexture2DArray2BulkData> MipData;
+	bool bMergeMips;
+	bool bSucceeded;
+};
+
+class FTexture2DArrayStreamingRequest : public FAsyncTask<FTexture2DArrayMipLoadTask>
+{
+public:
+	FTexture2DArrayStreamingRequest(const FTexture2DArray2Resource* Resource, FTexturePlatformData* PlatformData, int32 FirstMip, bool bMergeMips)
+		: FAsyncTask<FTexture2DArrayMipLoadTask>(Resource, PlatformData, FirstMip, bMergeMips)
+	{
+	}
+};
+
+/** Slice updates queued during a frame, sent to the render thread in a single command at its end. */
+class FTexture2DArraySliceUpdateQueue
+{
+public:
+	static FTexture2DArraySliceUpdateQueue& Get()
+	{
+		static FTexture2DArraySliceUpdateQueue Queue;
+		return Queue;
+	}
+
+	void Add(UTexture2DArray* Texture, FTexture2DArraySliceUpdate&& Update)
+	{
+		check(IsInGameThread());
+		PendingUpdates.FindOrAdd(Texture).Add(MoveTemp(Update));
+	}
+
+	void Remove(UTexture2DArray* Texture)
+	{
+		check(IsInGameThread());
+		PendingUpdates.Remove(Texture);
+	}
+
+private:
+	FTexture2DArraySliceUpdateQueue()
+	{
+		FCoreDelegates::OnEndFrame.AddRaw(this, &FTexture2DArraySliceUpdateQueue::Flush);
+		FCoreDelegates::OnPreExit.AddRaw(this, &FTexture2DArraySliceUpdateQueue::Shutdown);
+	}
+
+	/** Unbinds from the core delegates before exit, they may be gone by the time static objects are destroyed. */
+	void Shutdown()
+	{
+		FCoreDelegates::OnEndFrame.RemoveAll(this);
+		FCoreDelegates::OnPreExit.RemoveAll(this);
+		PendingUpdates.Empty();
+	}
+
+	void Flush()
+	{
+		if (PendingUpdates.Num() == 0)
+		{
+			return;
+		}
+
+		typedef TPair<FTexture2DArray2Resource*, TArray<FTexture2DArraySliceUpdate>> FResourceUpdates;
+		TArray<FResourceUpdates> Batch;
+		for (auto& TextureUpdates : PendingUpdates)
+		{
+			// Arrays without a resource get their data from scratch once created.
+			if (TextureUpdates.Key->Resource)
+			{
+				Batch.Emplace((FTexture2DArray2Resource*)TextureUpdates.Key->Resource, MoveTemp(TextureUpdates.Value));
+			}
+		}
+		PendingUpdates.Reset();
+
+		if (Batch.Num())
+		{
+			ENQUEUE_RENDER_COMMAND(FTexture2DArrayApplySliceUpdates)(
+				[Batch = MoveTemp(Batch)](FRHICommandListImmediate& RHICmdList) mutable
+				{
+					for (FResourceUpdates& ResourceUpdates : Batch)
+					{
+						ResourceUpdates.Key->ApplySliceUpdates(ResourceUpdates.Value);
+					}
+				});
+		}
+	}
+
+	TMap<UTexture2DArray*, TArray<FTexture2DArraySliceUpdate>> PendingUpdates;
 };
 
+void UTexture2DArray::BeginDestroy()
+{
+	FTexture2DArrayStreamingManager::Get().RemoveTexture(this);
+	FTexture2DArraySliceUpdateQueue::Get().Remove(this);
+	CancelStreaming();
+#if WITH_EDITOR
+	FTexture2DArrayBuilder::Get().Cancel(this);
+#endif // WITH_EDITOR
+
+	Super::BeginDestroy();
+}
+
+void UTexture2DArray::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+
+	// The exclusive size is what is resident now, the estimated total what the array takes once its mips are streamed in.
+	if (CumulativeResourceSize.GetResourceSizeMode() == EResourceSizeMode::Exclusive)
+	{
+		CumulativeResourceSize.AddDedicatedVideoMemoryBytes(CalcTextureMemorySizeEnum(TMC_ResidentMips));
+	}
+	else
+	{
+		CumulativeResourceSize.AddDedicatedVideoMemoryBytes(CalcTextureMemorySizeEnum(TMC_AllMipsBiased));
+	}
+}
+
 FTextureResource* UTexture2DArray::CreateResource()
 {
 	const FPixelFormatInfo& FormatInfo = GPixelFormats[GetPixelFormat()];
@@ -417,7 +1645,21 @@ FTextureResource* UTexture2DArray::CreateResource()
 
 	if (GetNumMips() > 0 && GSupportsTexture2DArray && bFormatIsSupported)
 	{
-		return new FTexture2DArray2Resource(this, GetCachedLODBias());
+		// Every array starts with a placeholder made of its smallest mips, nothing is loaded here.
+		// The streaming manager loads the other mips on a worker thread and uploads them within the frame budget.
+		int32 FirstMip = GetCachedLODBias();
+		while (FirstMip < GetNumMips() - 1 && FMath::Max(GetSizeX() >> FirstMip, GetSizeY() >> FirstMip) > TEXTURE_2D_ARRAY_PLACEHOLDER_SIZE)
+		{
+			++FirstMip;
+		}
+		FirstMip = FMath::Clamp(FirstMip, 0, GetNumMips() - 1);
+
+		ResidentMips = GetNumMips() - FirstMip;
+		WantedMips = ResidentMips;
+
+		FTexture2DArrayStreamingManager::Get().AddTexture(this);
+
+		return new FTexture2DArray2Resource(this, FirstMip);
 	}
 	else if (GetNumMips() == 0)
 	{
@@ -438,14 +1680,23 @@ FTextureResource* UTexture2DArray::CreateResource()
 
 void UTexture2DArray::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
 {
+	// Platform data may be rebuilt below, it must not be in use by a streaming request.
+	WaitForStreaming();
+
 	UProperty* PropertyThatChanged = PropertyChangedEvent.Property;
 	if (PropertyChangedEvent.Property)
 	{
 		static const FName SourceTextureName("Source2DTextures");
+		static const FName ReferenceSliceSourcesName("bReferenceSliceSources");
 
 		const FName PropertyName = PropertyChangedEvent.Property->GetFName();
 		if (PropertyName == SourceTextureName)
 		{
+			UpdateSourceFromSourceTexturesAsync();
+		}
+		else if (PropertyName == ReferenceSliceSourcesName && !bReferenceSliceSources && !LoadReferencedSourceSlices())
+		{
+			// The pixels are saved again from now on, reassemble them if they can't be read back as they were.
 			UpdateSourceFromSourceTextures();
 		}
 	}
@@ -459,6 +1710,16 @@ void UTexture2DArray::PostEditChangeProperty(FPropertyChangedEvent& PropertyChan
 
 void UTexture2DArray::UpdateResource()
 {
+#if WITH_EDITOR
+	// The background build updates the resource once its platform data is built.
+	if (IsUpdatingSourceAsync())
+	{
+		return;
+	}
+#endif // #if WITH_EDITOR
+
+	WaitForStreaming();
+
 #if WITH_EDITOR
 	// Recache platform data if the source has changed.
 	CachePlatformData();
@@ -470,6 +1731,160 @@ void UTexture2DArray::UpdateResource()
 
 //~ End UTexture Interface
 
+bool UTexture2DArray::IsStreamable() const
+{
+	return CVarTexture2DArrayStreaming.GetValueOnGameThread() != 0
+		&& IStreamingManager::Get().IsTextureStreamingEnabled()
+		&& !NeverStream
+		&& LODGroup != TEXTUREGROUP_UI
+		&& GetNumMips() > GetNumNonStreamingMips();
+}
+
+int32 UTexture2DArray::GetNumNonStreamingMips() const
+{
+	return PlatformData ? PlatformData->GetNumNonStreamingMips() : 0;
+}
+
+double UTexture2DArray::GetLastRenderTimeForStreaming() const
+{
+	double LastRenderTime = -FLT_MAX;
+	if (Resource)
+	{
+		// The last render time is the last time the resource was directly bound or the last
+		// time the texture reference was cached in a resource table, whichever was later.
+		LastRenderTime = FMath::Max<double>(Resource->LastRenderTime, TextureReference.GetLastRenderTime());
+	}
+	return LastRenderTime;
+}
+
+bool UTexture2DArray::StreamMips(int32 NewResidentMips)
+{
+	check(IsInGameThread());
+
+	if (PendingStreamingRequest || !Resource || !PlatformData || ((FTexture2DArray2Resource*)Resource)->IsUploadPending() || NewResidentMips < 1 || NewResidentMips > GetNumMips() || NewResidentMips == ResidentMips)
+	{
+		return false;
+	}
+
+	// Dropping mips keeps the resident ones, the render thread copies them to a smaller texture.
+	if (NewResidentMips < ResidentMips)
+	{
+		FTexture2DArray2Resource* ArrayResource = (FTexture2DArray2Resource*)Resource;
+		const int32 NewFirstMip = GetNumMips() - NewResidentMips;
+		ResidentMips = NewResidentMips;
+
+		ArrayResource->MarkUploadPending();
+		ENQUEUE_RENDER_COMMAND(FTexture2DArrayDropMips)(
+			[ArrayResource, NewFirstMip](FRHICommandListImmediate& RHICmdList)
+			{
+				ArrayResource->DropMips(NewFirstMip);
+			});
+		return true;
+	}
+
+	// Mips that fit in the upload budget are merged as they get loaded and the texture is created with them in one go,
+	// bigger requests are uploaded a few subresources per frame.
+	const int32 UploadBudgetKB = CVarTexture2DArrayUploadBudget.GetValueOnGameThread();
+	const bool bMergeMips = UploadBudgetKB <= 0 || CalcTextureMemorySize(NewResidentMips) <= (uint32)UploadBudgetKB * 1024;
+
+	PendingStreamingRequest = new FTexture2DArrayStreamingRequest((const FTexture2DArray2Resource*)Resource, PlatformData, GetNumMips() - NewResidentMips, bMergeMips);
+	PendingStreamingRequest->StartBackgroundTask();
+	return true;
+}
+
+bool UTexture2DArray::UpdateSlice(int32 SliceIndex, int32 FirstMip, TArray<TArray<uint8>> MipData)
+{
+	check(IsInGameThread());
+
+	if (SliceIndex < 0 || SliceIndex >= GetSizeZ() || FirstMip < 0 || MipData.Num() == 0 || FirstMip + MipData.Num() > GetNumMips())
+	{
+		UE_LOG(LogTexture, Warning, TEXT("Invalid update of slice %d, mips %d to %d, of %s."), SliceIndex, FirstMip, FirstMip + MipData.Num() - 1, *GetPathName());
+		return false;
+	}
+
+	const EPixelFormat Format = GetPixelFormat();
+	for (int32 MipOffset = 0; MipOffset < MipData.Num(); ++MipOffset)
+	{
+		const int32 MipIndex = FirstMip + MipOffset;
+		const int32 ExpectedSize = CalcTextureMipMapSize(GetSizeX(), GetSizeY(), Format, MipIndex);
+		if (MipData[MipOffset].Num() != ExpectedSize)
+		{
+			UE_LOG(LogTexture, Warning, TEXT("Update of slice %d of %s has %d bytes for mip %d, %d expected."), SliceIndex, *GetPathName(), MipData[MipOffset].Num(), MipIndex, ExpectedSize);
+			return false;
+		}
+	}
+
+	FTexture2DArraySliceUpdate Update;
+	Update.SliceIndex = SliceIndex;
+	Update.FirstMip = FirstMip;
+	Update.MipData = MoveTemp(MipData);
+	FTexture2DArraySliceUpdateQueue::Get().Add(this, MoveTemp(Update));
+	return true;
+}
+
+bool UTexture2DArray::UpdateStreamingStatus()
+{
+	check(IsInGameThread());
+
+	// Keep uploading the texture of the last request, no other request starts before it is swapped in.
+	FTexture2DArray2Resource* UploadingResource = (FTexture2DArray2Resource*)Resource;
+	if (UploadingResource && UploadingResource->IsUploadPending())
+	{
+		ENQUEUE_RENDER_COMMAND(FTexture2DArrayContinueUpload)(
+			[UploadingResource](FRHICommandListImmediate& RHICmdList)
+			{
+				UploadingResource->ContinuePendingUpload();
+			});
+		return true;
+	}
+
+	if (PendingStreamingRequest && PendingStreamingRequest->IsDone())
+	{
+		FTexture2DArrayMipLoadTask& LoadTask = PendingStreamingRequest->GetTask();
+		if (LoadTask.bSucceeded && Resource)
+		{
+			FTexture2DArray2Resource* ArrayResource = (FTexture2DArray2Resource*)Resource;
+			FTexture2DArray2BulkData* MipData = LoadTask.MipData.Release();
+			ResidentMips = GetNumMips() - MipData->GetFirstMip();
+
+			ArrayResource->MarkUploadPending();
+			ENQUEUE_RENDER_COMMAND(FTexture2DArrayUpdateMips)(
+				[ArrayResource, MipData](FRHICommandListImmediate& RHICmdList)
+				{
+					ArrayResource->UpdateMips(MipData);
+				});
+		}
+		else if (!LoadTask.bSucceeded)
+		{
+			UE_LOG(LogTexture, Warning, TEXT("Failed to stream mips of %s, keeping %d resident mips."), *GetPathName(), ResidentMips);
+		}
+
+		delete PendingStreamingRequest;
+		PendingStreamingRequest = nullptr;
+	}
+
+	return PendingStreamingRequest != nullptr;
+}
+
+void UTexture2DArray::WaitForStreaming()
+{
+	if (PendingStreamingRequest)
+	{
+		PendingStreamingRequest->EnsureCompletion();
+		UpdateStreamingStatus();
+	}
+}
+
+void UTexture2DArray::CancelStreaming()
+{
+	if (PendingStreamingRequest)
+	{
+		PendingStreamingRequest->EnsureCompletion();
+		delete PendingStreamingRequest;
+		PendingStreamingRequest = nullptr;
+	}
+}
+
 uint32 UTexture2DArray::CalcTextureMemorySize(int32 MipCount) const
 {
 	uint32 Size = 0;
@@ -478,20 +1893,19 @@ uint32 UTexture2DArray::CalcTextureMemorySize(int32 MipCount) const
 		const EPixelFormat Format = GetPixelFormat();
 		const uint32 Flags = (SRGB ? TexCreate_SRGB : 0) | TexCreate_OfflineProcessed | (bNoTiling ? TexCreate_NoTiling : 0);
 
-		
-		FIntPoint SizeXY;
-		uint32 SizeZ = GetSizeZ();
-		SizeXY = CalcMipMapExtent(GetSizeX(), GetSizeY(), Format, FMath::Max<int32>(0, GetNumMips() - MipCount));
-
-		uint32 TextureAlign = 0;
-		Size = (uint32)RHICalcTexture2DPlatformSize(SizeXY.X, SizeXY.Y, SizeZ, Format, MipCount, Flags, TextureAlign);
+		const FIntPoint SizeXY = CalcMipMapExtent(GetSizeX(), GetSizeY(), Format, FMath::Max<int32>(0, GetNumMips() - MipCount));
+		Size = CalcTexture2DArrayPlatformSize(SizeXY.X, SizeXY.Y, GetSizeZ(), Format, MipCount, Flags);
 	}
 	return Size;
 }
 
 uint32 UTexture2DArray::CalcTextureMemorySizeEnum(ETextureMipCount Enum) const
 {
-	if (Enum == TMC_ResidentMips || Enum == TMC_AllMipsBiased)
+	if (Enum == TMC_ResidentMips && Resource)
+	{
+		return CalcTextureMemorySize(ResidentMips);
+	}
+	else if (Enum == TMC_ResidentMips || Enum == TMC_AllMipsBiased)
 	{
 		return CalcTextureMemorySize(GetNumMips() - GetCachedLODBias());
 	}
@@ -501,6 +1915,57 @@ uint32 UTexture2DArray::CalcTextureMemorySizeEnum(ETextureMipCount Enum) const
 	}
 }
 
+/** Lists the loaded texture 2D arrays sorted by resident size, also part of memreport. */
+static bool Texture2DArrayExec(UWorld* InWorld, const TCHAR* Cmd, FOutputDevice& Ar)
+{
+	if (!FParse::Command(&Cmd, TEXT("ListTexture2DArrays")))
+	{
+		return false;
+	}
+
+	TArray<UTexture2DArray*> Textures;
+	for (TObjectIterator<UTexture2DArray> It; It; ++It)
+	{
+		Textures.Add(*It);
+	}
+	Textures.Sort([](const UTexture2DArray& A, const UTexture2DArray& B)
+	{
+		return A.CalcTextureMemorySizeEnum(TMC_ResidentMips) > B.CalcTextureMemorySizeEnum(TMC_ResidentMips);
+	});
+
+	Ar.Logf(TEXT("Listing %d texture 2D arrays."), Textures.Num());
+	Ar.Logf(TEXT("SizeX x SizeY x Slices, Format, Resident Mips / Mips, Resident KB, Full KB, Render Thread ms, Streamable, Name"));
+
+	uint64 TotalResidentSize = 0;
+	uint64 TotalFullSize = 0;
+	for (const UTexture2DArray* Texture : Textures)
+	{
+		const uint32 ResidentSize = Texture->CalcTextureMemorySizeEnum(TMC_ResidentMips);
+		const uint32 FullSize = Texture->CalcTextureMemorySizeEnum(TMC_AllMipsBiased);
+		const float RenderThreadTimeMs = Texture->Resource ? ((const FTexture2DArray2Resource*)Texture->Resource)->GetRenderThreadTimeMs() : 0.0f;
+		TotalResidentSize += ResidentSize;
+		TotalFullSize += FullSize;
+
+		Ar.Logf(TEXT("%dx%dx%d, %s, %d/%d, %d, %d, %.2f, %s, %s"),
+			Texture->GetSizeX(),
+			Texture->GetSizeY(),
+			Texture->GetSizeZ(),
+			GPixelFormats[Texture->GetPixelFormat()].Name,
+			Texture->GetNumResidentMips(),
+			Texture->GetNumMips(),
+			ResidentSize / 1024,
+			FullSize / 1024,
+			RenderThreadTimeMs,
+			Texture->IsStreamable() ? TEXT("YES") : TEXT("NO"),
+			*Texture->GetPathName());
+	}
+
+	Ar.Logf(TEXT("Total texture 2D array size: Resident=%.2fMB, Full=%.2fMB"), TotalResidentSize / 1024.0f / 1024.0f, TotalFullSize / 1024.0f / 1024.0f);
+	return true;
+}
+
+static FStaticSelfRegisteringExec Texture2DArrayExecRegistration(&Texture2DArrayExec);
+
 #if WITH_EDITOR
 
 uint32 UTexture2DArray::GetMaximumDimension() const
@@ -532,12 +1997,15 @@ bool UTexture2DArray::ShaderPlatformSupportsCompression(EShaderPlatform ShaderPl
 
 void UTexture2DArray::UpdateMipGenSettings()
 {
-	if (!Source.IsPowerOfTwo())
+	// NPT arrays are built without mips when they can't get a rounded down mip chain, the build settings take care of it.
+	// They are not streamed, some of their mips are not whole 4x4 blocks and a texture can't start with one of them.
+	if (!Source.IsPowerOfTwo() && !NeverStream)
 	{
-		// Force NPT textures to have no mipmaps.
-		MipGenSettings = TMGS_NoMipmaps;
+		UE_LOG(LogTexture, Log, TEXT("%s is %dx%d, not a power of two, streaming is disabled for it."), *GetPathName(), Source.GetSizeX(), Source.GetSizeY());
 		NeverStream = true;
 	}
 }
 
-#endif // #if WITH_EDITOR
\ No newline at end of file
+#endif // #if WITH_EDITOR
+
+#undef LOCTEXT_NAMESPACE
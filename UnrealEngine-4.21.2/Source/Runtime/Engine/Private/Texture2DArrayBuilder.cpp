@@ -0,0 +1,409 @@
+#include "Texture2DArrayBuilder.h"
+
+#if WITH_EDITOR
+
+#include "Engine/Texture2DArray.h"
+#include "Async/ParallelFor.h"
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Modules/ModuleManager.h"
+#include "Misc/CoreDelegates.h"
+#include "IImageWrapperModule.h"
+#include "Framework/Notifications/NotificationManager.h"
+#include "Widgets/Notifications/SNotificationList.h"
+
+#define LOCTEXT_NAMESPACE "Texture2DArrayBuilder"
+
+/** Reads slice texture sources into a new array source, decoding them in parallel. */
+class FTexture2DArraySourceReadTask : public FNonAbandonableTask
+{
+public:
+	FTexture2DArraySourceReadTask(const TArray<UTexture2D*>& SliceTextures, const TArray<int32>& SlicesToRead, int32 InSliceSize)
+		: SliceSize(InSliceSize)
+		, NumSlicesToRead(SlicesToRead.Num())
+	{
+		// Modules can't be loaded off the game thread.
+		ImageWrapperModule = &FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+
+		// A texture used by several slices is read once and copied to the others.
+		// Every source is copied here, a slice texture reimported while the slices are read doesn't change what the workers see.
+		TMap<const UTexture2D*, int32> TextureReadIndices;
+		for (int32 SliceIndex : SlicesToRead)
+		{
+			const UTexture2D* SliceTexture = SliceTextures[SliceIndex];
+			if (const int32* ReadIndex = TextureReadIndices.Find(SliceTexture))
+			{
+				DuplicateSlices.Emplace(SliceIndex, ReadSliceIndices[*ReadIndex]);
+			}
+			else
+			{
+				TextureReadIndices.Add(SliceTexture, ReadSliceIndices.Add(SliceIndex));
+				new(SliceSources) FTextureSource(SliceTexture->Source);
+			}
+		}
+
+		Data.SetNumUninitialized(SliceTextures.Num() * SliceSize);
+	}
+
+	void DoWork()
+	{
+		ParallelFor(ReadSliceIndices.Num(), [this](int32 ReadIndex)
+		{
+			if (bCancelled)
+			{
+				return;
+			}
+
+			// Sources that were not loaded are loaded with their own file reader, loading them from the package is not thread safe.
+			FTextureSource& SliceSource = SliceSources[ReadIndex];
+			const bool bLoaded = SliceSource.IsBulkDataLoaded() || SliceSource.LoadBulkDataWithFileReader();
+
+			TArray<uint8> ScratchData;
+			if (!bLoaded || !UTexture2DArray::ReadSliceSourceMip(SliceSource, SliceSize, Data.GetData() + ReadSliceIndices[ReadIndex] * SliceSize, ScratchData, ImageWrapperModule))
+			{
+				NumSlicesFailed.Increment();
+			}
+			SliceSource.RemoveBulkData();
+
+			NumSlicesRead.Increment();
+		});
+
+		if (!bCancelled)
+		{
+			for (const TPair<int32, int32>& DuplicateSlice : DuplicateSlices)
+			{
+				FMemory::Memcpy(Data.GetData() + DuplicateSlice.Key * SliceSize, Data.GetData() + DuplicateSlice.Value * SliceSize, SliceSize);
+			}
+			NumSlicesRead.Add(DuplicateSlices.Num());
+		}
+	}
+
+	void Cancel()
+	{
+		bCancelled = true;
+	}
+
+	int32 GetNumSlicesToRead() const { return NumSlicesToRead; }
+	int32 GetNumSlicesRead() const { return NumSlicesRead.GetValue(); }
+	int32 GetNumSlicesFailed() const { return NumSlicesFailed.GetValue(); }
+
+	/** The array source, only the slices that were read are set. */
+	TArray<uint8> Data;
+
+	FORCEINLINE TStatId GetStatId() const
+	{
+		RETURN_QUICK_DECLARE_CYCLE_STAT(FTexture2DArraySourceReadTask, STATGROUP_ThreadPoolAsyncTasks);
+	}
+
+private:
+	/** Slices read from their texture, one per texture. */
+	TArray<int32> ReadSliceIndices;
+	/** Copies of the sources of the slices read. */
+	TIndirectArray<FTextureSource> SliceSources;
+	/** Slices copied from another slice of the same texture once read, as pairs of slice index and read slice index. */
+	TArray<TPair<int32, int32>> DuplicateSlices;
+	int32 SliceSize;
+	int32 NumSlicesToRead;
+	IImageWrapperModule* ImageWrapperModule;
+	FThreadSafeCounter NumSlicesRead;
+	FThreadSafeCounter NumSlicesFailed;
+	FThreadSafeBool bCancelled;
+};
+
+FTexture2DArrayBuilder& FTexture2DArrayBuilder::Get()
+{
+	static FTexture2DArrayBuilder Builder;
+	return Builder;
+}
+
+FTexture2DArrayBuilder::FTexture2DArrayBuilder()
+{
+	TickHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FTexture2DArrayBuilder::Tick));
+	FCoreDelegates::OnPreExit.AddRaw(this, &FTexture2DArrayBuilder::Shutdown);
+}
+
+FTexture2DArrayBuilder::~FTexture2DArrayBuilder()
+{
+}
+
+void FTexture2DArrayBuilder::Shutdown()
+{
+	FCoreDelegates::OnPreExit.RemoveAll(this);
+	while (Builds.Num())
+	{
+		Cancel(Builds.Last()->Texture);
+	}
+	if (TickHandle.IsValid())
+	{
+		FTicker::GetCoreTicker().RemoveTicker(TickHandle);
+		TickHandle.Reset();
+	}
+}
+
+void FTexture2DArrayBuilder::Build(UTexture2DArray* Texture)
+{
+	check(IsInGameThread());
+
+	Cancel(Texture);
+
+	TUniquePtr<FBuild> Build = MakeUnique<FBuild>();
+	Build->Texture = Texture;
+	Build->State = FBuild::EState::ReadingSlices;
+
+	const int32 NumSlices = Texture->Source2DTextures.Num();
+	if (NumSlices == 0 || !Texture->GetSourceTexturesLayout(Build->SizeX, Build->SizeY, Build->Format))
+	{
+		// The source is cleared, there is nothing to build.
+		Texture->UpdateSourceFromSourceTextures();
+		Texture->UpdateResource();
+		return;
+	}
+
+	Build->SliceSize = Texture->Source2DTextures[0]->Source.CalcMipSize(0);
+
+	// Slices that are already in the current source are copied from it instead of being read again.
+	TMap<FGuid, int32> OldSliceIndices;
+	if (Texture->CanPatchSource(Build->SizeX, Build->SizeY, Build->Format))
+	{
+		Build->OldSliceIds = Texture->SourceSliceIds;
+		for (int32 OldSliceIndex = 0; OldSliceIndex < Texture->SourceSliceIds.Num(); ++OldSliceIndex)
+		{
+			if (Texture->SourceSliceIds[OldSliceIndex].IsValid() && !OldSliceIndices.Contains(Texture->SourceSliceIds[OldSliceIndex]))
+			{
+				OldSliceIndices.Add(Texture->SourceSliceIds[OldSliceIndex], OldSliceIndex);
+			}
+		}
+	}
+
+	TArray<int32> SlicesToRead;
+	for (int32 SliceIndex = 0; SliceIndex < NumSlices; ++SliceIndex)
+	{
+		const FGuid SliceId = Texture->Source2DTextures[SliceIndex]->Source.GetId();
+		const int32* OldSliceIndex = SliceId.IsValid() ? OldSliceIndices.Find(SliceId) : nullptr;
+
+		Build->SliceIds.Add(SliceId);
+		Build->SliceOrigins.Add(OldSliceIndex ? *OldSliceIndex : INDEX_NONE);
+		if (!OldSliceIndex)
+		{
+			SlicesToRead.Add(SliceIndex);
+		}
+	}
+
+	if (SlicesToRead.Num() == 0)
+	{
+		// Slices are only moved around, that is quick enough to do right away.
+		Texture->UpdateSourceFromSourceTextures();
+		BeginCachePlatformData(*Build);
+	}
+	else
+	{
+		Build->ReadTask = MakeUnique<FAsyncTask<FTexture2DArraySourceReadTask>>(Texture->Source2DTextures, SlicesToRead, Build->SliceSize);
+		Build->ReadTask->StartBackgroundTask(GLargeThreadPool);
+
+		// The notification may outlive the build, it only keeps a weak reference to the texture.
+		TWeakObjectPtr<UTexture2DArray> WeakTexture = Texture;
+		FNotificationInfo Info(FText::GetEmpty());
+		Info.bFireAndForget = false;
+		Info.ButtonDetails.Add(FNotificationButtonInfo(
+			LOCTEXT("CancelBuild", "Cancel"),
+			LOCTEXT("CancelBuildTooltip", "Stops reading the slices, the array keeps its previous content."),
+			FSimpleDelegate::CreateLambda([this, WeakTexture]()
+			{
+				if (UTexture2DArray* CancelledTexture = WeakTexture.Get())
+				{
+					Cancel(CancelledTexture);
+				}
+			}),
+			SNotificationItem::CS_Pending));
+
+		Build->Notification = FSlateNotificationManager::Get().AddNotification(Info);
+		UpdateNotification(*Build);
+		if (Build->Notification.IsValid())
+		{
+			Build->Notification->SetCompletionState(SNotificationItem::CS_Pending);
+		}
+	}
+
+	Builds.Add(MoveTemp(Build));
+}
+
+void FTexture2DArrayBuilder::Cancel(UTexture2DArray* Texture)
+{
+	check(IsInGameThread());
+
+	const int32 BuildIndex = FindBuild(Texture);
+	if (BuildIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	// Removed first, finishing the platform data may rewrite the source and cancel the build again.
+	TUniquePtr<FBuild> Build = MoveTemp(Builds[BuildIndex]);
+	Builds.RemoveAt(BuildIndex);
+
+	if (Build->State == FBuild::EState::ReadingSlices)
+	{
+		Build->ReadTask->GetTask().Cancel();
+		Build->ReadTask->EnsureCompletion();
+		CloseNotification(*Build, false, FText::Format(LOCTEXT("BuildCancelled", "Cancelled building {0}"), FText::FromName(Texture->GetFName())));
+	}
+	else
+	{
+		// The resource is left released, it is updated by whoever replaces or destroys the build.
+		Texture->FinishCachePlatformData();
+		CloseNotification(*Build, true, FText::Format(LOCTEXT("BuildDone", "Built {0}"), FText::FromName(Texture->GetFName())));
+	}
+}
+
+bool FTexture2DArrayBuilder::IsBuilding(const UTexture2DArray* Texture) const
+{
+	return FindBuild(Texture) != INDEX_NONE;
+}
+
+bool FTexture2DArrayBuilder::Tick(float DeltaTime)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_Texture2DArrayBuilder_Tick);
+
+	for (int32 BuildIndex = Builds.Num() - 1; BuildIndex >= 0; --BuildIndex)
+	{
+		FBuild& Build = *Builds[BuildIndex];
+		if (Build.State == FBuild::EState::ReadingSlices)
+		{
+			if (!Build.ReadTask->IsDone())
+			{
+				UpdateNotification(Build);
+				continue;
+			}
+
+			if (Build.ReadTask->GetTask().GetNumSlicesFailed() > 0)
+			{
+				// Sources a file reader can't load, such as the ones of packages that were never saved, are read from their package on the game thread.
+				UTexture2DArray* Texture = Build.Texture;
+				CloseNotification(Build, false, FText::Format(LOCTEXT("SlicesReadFailed", "Failed to read {0} slices of {1} in the background, reading them again"),
+					FText::AsNumber(Build.ReadTask->GetTask().GetNumSlicesFailed()), FText::FromName(Texture->GetFName())));
+				UE_LOG(LogTexture, Warning, TEXT("Failed to read %d slices of %s in the background, reading its slices on the game thread."), Build.ReadTask->GetTask().GetNumSlicesFailed(), *Texture->GetPathName());
+
+				// Removed first, rewriting the source cancels the build of the texture.
+				TUniquePtr<FBuild> SyncBuild = MoveTemp(Builds[BuildIndex]);
+				Builds.RemoveAt(BuildIndex);
+				SyncBuild->ReadTask.Reset();
+				Texture->UpdateSourceFromSourceTextures();
+				BeginCachePlatformData(*SyncBuild);
+				Builds.Add(MoveTemp(SyncBuild));
+				continue;
+			}
+
+			if (!ApplySource(Build))
+			{
+				// The source was rewritten while the slices were read, the reused slices are not where they were anymore.
+				UTexture2DArray* Texture = Build.Texture;
+				CloseNotification(Build, false, FText::Format(LOCTEXT("BuildRestarted", "Restarted building {0}, its source changed"), FText::FromName(Texture->GetFName())));
+				Builds.RemoveAt(BuildIndex);
+				this->Build(Texture);
+				continue;
+			}
+			Build.ReadTask.Reset();
+			CloseNotification(Build, true, FText::Format(LOCTEXT("SlicesRead", "Read the slices of {0}"), FText::FromName(Build.Texture->GetFName())));
+			BeginCachePlatformData(Build);
+		}
+		else if (Build.Texture->IsAsyncCacheComplete())
+		{
+			UTexture2DArray* Texture = Build.Texture;
+			CloseNotification(Build, true, FText::Format(LOCTEXT("BuildDone", "Built {0}"), FText::FromName(Texture->GetFName())));
+			Builds.RemoveAt(BuildIndex);
+
+			Texture->FinishCachePlatformData();
+			Texture->UpdateResource();
+		}
+	}
+
+	return true;
+}
+
+bool FTexture2DArrayBuilder::ApplySource(FBuild& Build)
+{
+	UTexture2DArray* Texture = Build.Texture;
+	TArray<uint8>& Data = Build.ReadTask->GetTask().Data;
+	const int32 NumSlices = Build.SliceIds.Num();
+
+	bool bHasReusedSlices = false;
+	for (int32 SliceOrigin : Build.SliceOrigins)
+	{
+		bHasReusedSlices |= SliceOrigin != INDEX_NONE;
+	}
+
+	if (bHasReusedSlices)
+	{
+		if (!Texture->CanPatchSource(Build.SizeX, Build.SizeY, Build.Format) || Texture->SourceSliceIds != Build.OldSliceIds)
+		{
+			return false;
+		}
+
+		const uint8* OldData = (const uint8*)Texture->Source.BulkData.Lock(LOCK_READ_ONLY);
+		for (int32 SliceIndex = 0; SliceIndex < NumSlices; ++SliceIndex)
+		{
+			if (Build.SliceOrigins[SliceIndex] != INDEX_NONE)
+			{
+				FMemory::Memcpy(Data.GetData() + SliceIndex * Build.SliceSize, OldData + Build.SliceOrigins[SliceIndex] * Build.SliceSize, Build.SliceSize);
+			}
+		}
+		Texture->Source.BulkData.Unlock();
+	}
+
+	Texture->Source.Init(Build.SizeX, Build.SizeY, NumSlices, 1, Build.Format, Data.GetData());
+	Data.Empty();
+
+	Texture->SourceSliceIds = MoveTemp(Build.SliceIds);
+	Texture->SetLightingGuid(); // Because the content has changed, use a new GUID.
+	Texture->UpdateMipGenSettings();
+	return true;
+}
+
+void FTexture2DArrayBuilder::BeginCachePlatformData(FBuild& Build)
+{
+	UTexture2DArray* Texture = Build.Texture;
+	Build.State = FBuild::EState::CachingPlatformData;
+
+	// The platform data is rebuilt in place, nothing may read it until done. Materials use the default texture meanwhile.
+	Texture->WaitForStreaming();
+	Texture->ReleaseResource();
+	Texture->CachePlatformData(/*bAsyncCache=*/ true, /*bAllowAsyncBuild=*/ true);
+
+	FNotificationInfo Info(FText::Format(LOCTEXT("BuildingPlatformData", "Building {0}"), FText::FromName(Texture->GetFName())));
+	Info.bFireAndForget = false;
+	Build.Notification = FSlateNotificationManager::Get().AddNotification(Info);
+	if (Build.Notification.IsValid())
+	{
+		Build.Notification->SetCompletionState(SNotificationItem::CS_Pending);
+	}
+}
+
+void FTexture2DArrayBuilder::UpdateNotification(FBuild& Build)
+{
+	if (Build.Notification.IsValid() && Build.ReadTask)
+	{
+		const FTexture2DArraySourceReadTask& ReadTask = Build.ReadTask->GetTask();
+		Build.Notification->SetText(FText::Format(LOCTEXT("ReadingSlices", "Reading slices of {0} ({1}/{2})"),
+			FText::FromName(Build.Texture->GetFName()), FText::AsNumber(ReadTask.GetNumSlicesRead()), FText::AsNumber(ReadTask.GetNumSlicesToRead())));
+	}
+}
+
+void FTexture2DArrayBuilder::CloseNotification(FBuild& Build, bool bSucceeded, const FText& Text)
+{
+	if (Build.Notification.IsValid())
+	{
+		Build.Notification->SetText(Text);
+		Build.Notification->SetCompletionState(bSucceeded ? SNotificationItem::CS_Success : SNotificationItem::CS_Fail);
+		Build.Notification->ExpireAndFadeout();
+		Build.Notification.Reset();
+	}
+}
+
+int32 FTexture2DArrayBuilder::FindBuild(const UTexture2DArray* Texture) const
+{
+	return Builds.IndexOfByPredicate([Texture](const TUniquePtr<FBuild>& Build) { return Build->Texture == Texture; });
+}
+
+#undef LOCTEXT_NAMESPACE
+
+#endif // WITH_EDITOR
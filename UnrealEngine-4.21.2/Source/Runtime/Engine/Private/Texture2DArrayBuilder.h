@@ -0,0 +1,102 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if WITH_EDITOR
+
+#include "Containers/Ticker.h"
+#include "Async/AsyncWork.h"
+#include "Engine/Texture.h"
+
+class UTexture2DArray;
+class SNotificationItem;
+class FTexture2DArraySourceReadTask;
+
+/**
+ * Reassembles texture 2D array sources and rebuilds their platform data in the background.
+ * Slices are read on the thread pool while the array keeps its current resource, the source is then
+ * replaced on the game thread and the platform data is built by an async DDC task.
+ * Each build shows its progress in a notification, reading slices can be cancelled from it.
+ * Slices that fail to read in the background are read again on the game thread, which reports the ones that still fail.
+ */
+class FTexture2DArrayBuilder
+{
+public:
+	static FTexture2DArrayBuilder& Get();
+
+	/** Starts rebuilding a texture from its slice textures, replacing the build already running for it, if any. */
+	void Build(UTexture2DArray* Texture);
+
+	/**
+	 * Stops the build of a texture. Slices being read are dropped and the source is left as it was,
+	 * a platform data build can't be stopped and is waited for.
+	 */
+	void Cancel(UTexture2DArray* Texture);
+
+	/** Whether a build is running for a texture. */
+	bool IsBuilding(const UTexture2DArray* Texture) const;
+
+private:
+	FTexture2DArrayBuilder();
+	~FTexture2DArrayBuilder();
+
+	struct FBuild
+	{
+		enum class EState
+		{
+			ReadingSlices,
+			CachingPlatformData,
+		};
+
+		UTexture2DArray* Texture;
+		EState State;
+
+		/** Source GUIDs of the slices being assembled. */
+		TArray<FGuid> SliceIds;
+
+		/** For each slice, the slice of the current source holding the same content, or INDEX_NONE if it is read. */
+		TArray<int32> SliceOrigins;
+
+		/** Slice GUIDs of the current source when the build started, empty if no slice is reused from it. */
+		TArray<FGuid> OldSliceIds;
+
+		int32 SizeX;
+		int32 SizeY;
+		int32 SliceSize;
+		ETextureSourceFormat Format;
+
+		/** Reads the slices that are not in the current source, null if there are none. */
+		TUniquePtr<FAsyncTask<FTexture2DArraySourceReadTask>> ReadTask;
+
+		TSharedPtr<SNotificationItem> Notification;
+	};
+
+	/** Stops the running builds and unregisters the ticker before exit, the core ticker may be gone by the time static objects are destroyed. */
+	void Shutdown();
+
+	/** Polls the running builds, moving them to their next step once done. */
+	bool Tick(float DeltaTime);
+
+	/**
+	 * Replaces the source of the texture with the assembled slices.
+	 * @return false if the current source changed since the build started, the slices to reuse can't be found in it.
+	 */
+	bool ApplySource(FBuild& Build);
+
+	/** Starts building the platform data of the texture, it has no resource until done. */
+	void BeginCachePlatformData(FBuild& Build);
+
+	/** Shows the progress of a build. */
+	void UpdateNotification(FBuild& Build);
+
+	/** Closes the notification of a build. */
+	static void CloseNotification(FBuild& Build, bool bSucceeded, const FText& Text);
+
+	int32 FindBuild(const UTexture2DArray* Texture) const;
+
+	TArray<TUniquePtr<FBuild>> Builds;
+
+	FDelegateHandle TickHandle;
+};
+
+#endif // WITH_EDITOR
@@ -0,0 +1,844 @@
+#include "Texture2DArrayDerivedData.h"
+
+#if WITH_EDITOR
+
+#include "Engine/Texture2DArray.h"
+#include "Engine/Texture2D.h"
+#include "TextureCompressorModule.h"
+#include "ImageCore.h"
+#include "DerivedDataCacheInterface.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Async/ParallelFor.h"
+#include "Engine/TextureDefines.h"
+#include "Misc/SecureHash.h"
+#include "Misc/CoreMisc.h"
+#include "Misc/ScopeLock.h"
+
+/** Version of the slice content hashes stored for each array, change it to rehash every array source. */
+#define TEXTURE2DARRAY_SLICEHASHES_DERIVEDDATA_VER	TEXT("77D256B870EA403FBED48E8C0528A9DC")
+
+/** Serializes the compressed mip chain of a single array slice. */
+static void SerializeCompressedSlice(FArchive& Ar, TArray<FCompressedImage2D>& Mips)
+{
+	int32 NumMips = Mips.Num();
+	Ar << NumMips;
+
+	if (Ar.IsLoading())
+	{
+		Mips.Empty(NumMips);
+		Mips.AddZeroed(NumMips);
+	}
+
+	for (FCompressedImage2D& Mip : Mips)
+	{
+		Ar << Mip.SizeX;
+		Ar << Mip.SizeY;
+		Ar << Mip.PixelFormat;
+		Mip.RawData.BulkSerialize(Ar);
+		Mip.SizeZ = 1;
+	}
+}
+
+/**
+ * Hashes the source content of a slice, identical slices get the same hash whichever texture they come from.
+ * Every source mip is hashed, along with the layout and gamma the slice is read with.
+ */
+static FString CalcSliceContentHash(const TArray<FImage>& SourceMips, int32 SliceIndex)
+{
+	FSHA1 HashState;
+	for (const FImage& SourceMip : SourceMips)
+	{
+		const int32 SliceHeader[] = { SourceMip.SizeX, SourceMip.SizeY, (int32)SourceMip.Format, (int32)SourceMip.GammaSpace };
+		HashState.Update((const uint8*)SliceHeader, sizeof(SliceHeader));
+
+		const int32 SliceSize = SourceMip.RawData.Num() / SourceMip.NumSlices;
+		HashState.Update(SourceMip.RawData.GetData() + SliceIndex * SliceSize, SliceSize);
+	}
+	HashState.Final();
+
+	FSHAHash Hash;
+	HashState.GetHash(Hash.Hash);
+	return Hash.ToString();
+}
+
+/**
+ * Source content hashes of the slices of the arrays built or cooked in this session, the same hashes their compressed
+ * slices are keyed by in the DDC. Lists the slices shared between arrays, their compressed data is only built once.
+ */
+class FTexture2DArraySliceIndex
+{
+public:
+	static FTexture2DArraySliceIndex& Get()
+	{
+		static FTexture2DArraySliceIndex Index;
+		return Index;
+	}
+
+	/** Records the slices an array is assembled from, replacing the ones recorded for it before. */
+	void SetArraySlices(const FString& ArrayName, const TArray<FString>& SliceHashes)
+	{
+		FScopeLock Lock(&CriticalSection);
+		ArraySlices.Add(ArrayName, SliceHashes);
+	}
+
+	/** Logs the slices used by several arrays, or several times by the same array. */
+	void Report(FOutputDevice& Ar) const
+	{
+		FScopeLock Lock(&CriticalSection);
+
+		TMap<FString, TArray<FString>> SliceUsers;
+		int32 NumSlices = 0;
+		for (const auto& Array : ArraySlices)
+		{
+			for (int32 SliceIndex = 0; SliceIndex < Array.Value.Num(); ++SliceIndex)
+			{
+				SliceUsers.FindOrAdd(Array.Value[SliceIndex]).Add(FString::Printf(TEXT("%s[%d]"), *Array.Key, SliceIndex));
+				++NumSlices;
+			}
+		}
+
+		Ar.Logf(TEXT("Listing the slices shared by %d texture 2D arrays built or cooked in this session."), ArraySlices.Num());
+		Ar.Logf(TEXT("Uses, Slice Content, Arrays"));
+
+		int32 NumSharedSlices = 0;
+		for (const auto& Slice : SliceUsers)
+		{
+			if (Slice.Value.Num() > 1)
+			{
+				Ar.Logf(TEXT("%d, %s, %s"), Slice.Value.Num(), *Slice.Key, *FString::Join(Slice.Value, TEXT(" ")));
+				++NumSharedSlices;
+			}
+		}
+
+		Ar.Logf(TEXT("%d slices, %d unique, %d shared."), NumSlices, SliceUsers.Num(), NumSharedSlices);
+	}
+
+private:
+	mutable FCriticalSection CriticalSection;
+
+	/** Slice content hashes of each array, by array path name. */
+	TMap<FString, TArray<FString>> ArraySlices;
+};
+
+/** Whether every slice of an array has a source GUID, arrays imported as a whole are not built per slice. */
+static bool HasSliceIds(const UTexture2DArray& Texture)
+{
+	for (const FGuid& SliceId : Texture.SourceSliceIds)
+	{
+		if (!SliceId.IsValid())
+		{
+			return false;
+		}
+	}
+	return Texture.SourceSliceIds.Num() > 0;
+}
+
+/**
+ * Computes the derived data key the slice content hashes of an array are stored under.
+ * @param Texture - The texture 2D array.
+ * @param NumSourceMips - Number of source mips the slices are hashed from.
+ * @param GammaSpace - Gamma space the source is read with.
+ */
+static FString GetSliceHashesDerivedDataKey(const UTexture2DArray& Texture, int32 NumSourceMips, EGammaSpace GammaSpace)
+{
+	return FDerivedDataCacheInterface::BuildCacheKey(
+		TEXT("TEXTURE2DARRAYSLICEHASHES"),
+		TEXTURE2DARRAY_SLICEHASHES_DERIVEDDATA_VER,
+		*FString::Printf(TEXT("%s_%d_%d"), *Texture.Source.GetId().ToString(), NumSourceMips, (int32)GammaSpace)
+		);
+}
+
+/** Reads the source mips of an array the way its platform data build does, to hash its slices. */
+static bool GetSliceHashSourceMips(UTexture2DArray& Texture, int32 NumSourceMips, EGammaSpace GammaSpace, TArray<FImage>& OutMips)
+{
+	ERawImageFormat::Type ImageFormat;
+	switch (Texture.Source.GetFormat())
+	{
+	case TSF_G8:		ImageFormat = ERawImageFormat::G8;		break;
+	case TSF_BGRA8:		ImageFormat = ERawImageFormat::BGRA8;	break;
+	case TSF_BGRE8:		ImageFormat = ERawImageFormat::BGRE8;	break;
+	case TSF_RGBA16:	ImageFormat = ERawImageFormat::RGBA16;	break;
+	case TSF_RGBA16F:	ImageFormat = ERawImageFormat::RGBA16F; break;
+	default:
+		return false;
+	}
+
+	for (int32 MipIndex = 0; MipIndex < NumSourceMips; ++MipIndex)
+	{
+		FImage* SourceMip = new(OutMips) FImage(
+			FMath::Max(1, Texture.Source.GetSizeX() >> MipIndex),
+			FMath::Max(1, Texture.Source.GetSizeY() >> MipIndex),
+			Texture.Source.GetNumSlices(),
+			ImageFormat,
+			GammaSpace
+			);
+
+		if (!Texture.Source.GetMipData(SourceMip->RawData, MipIndex))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void RecordTexture2DArraySlices(UTexture2DArray& Texture, const FTextureBuildSettings& BuildSettings)
+{
+	if (!HasSliceIds(Texture) || !Texture.Source.IsValid())
+	{
+		return;
+	}
+
+	// Same source mips and gamma as FTextureCacheDerivedDataWorker reads, the hashes must match the ones the build keys slices by.
+	const int32 NumSourceMips = BuildSettings.MipGenSettings == TMGS_LeaveExistingMips ? Texture.Source.GetNumMips() : 1;
+	const EGammaSpace GammaSpace = Texture.SRGB ? (Texture.bUseLegacyGamma ? EGammaSpace::Pow22 : EGammaSpace::sRGB) : EGammaSpace::Linear;
+	const FString SliceHashesKey = GetSliceHashesDerivedDataKey(Texture, NumSourceMips, GammaSpace);
+
+	TArray<FString> SliceHashes;
+	TArray<uint8> RawSliceHashes;
+	if (GetDerivedDataCacheRef().GetSynchronous(*SliceHashesKey, RawSliceHashes))
+	{
+		FMemoryReader Ar(RawSliceHashes, /*bIsPersistent=*/ true);
+		Ar << SliceHashes;
+	}
+
+	// Arrays whose platform data was cached before their hashes were stored are hashed from their source once.
+	if (SliceHashes.Num() != Texture.SourceSliceIds.Num())
+	{
+		TArray<FImage> SourceMips;
+		if (!GetSliceHashSourceMips(Texture, NumSourceMips, GammaSpace, SourceMips) || SourceMips[0].NumSlices != Texture.SourceSliceIds.Num())
+		{
+			UE_LOG(LogTexture, Warning, TEXT("Cannot read the source of %s to record its slices."), *Texture.GetPathName());
+			return;
+		}
+
+		SliceHashes.SetNum(SourceMips[0].NumSlices);
+		ParallelFor(SliceHashes.Num(), [&](int32 SliceIndex)
+		{
+			SliceHashes[SliceIndex] = CalcSliceContentHash(SourceMips, SliceIndex);
+		});
+
+		RawSliceHashes.Reset();
+		FMemoryWriter Ar(RawSliceHashes, /*bIsPersistent=*/ true);
+		Ar << SliceHashes;
+		GetDerivedDataCacheRef().Put(*SliceHashesKey, RawSliceHashes);
+	}
+
+	FTexture2DArraySliceIndex::Get().SetArraySlices(Texture.GetPathName(), SliceHashes);
+}
+
+/** Lists the slices shared between the texture 2D arrays built or cooked in this session, useful at the end of a cook. */
+static bool Texture2DArrayDerivedDataExec(UWorld* InWorld, const TCHAR* Cmd, FOutputDevice& Ar)
+{
+	if (!FParse::Command(&Cmd, TEXT("ListSharedTexture2DArraySlices")))
+	{
+		return false;
+	}
+
+	FTexture2DArraySliceIndex::Get().Report(Ar);
+	return true;
+}
+
+static FStaticSelfRegisteringExec Texture2DArrayDerivedDataExecRegistration(&Texture2DArrayDerivedDataExec);
+
+/** Formats whose compressors only encode whole 4x4 blocks, non power of two mips are padded for them. */
+static const FName GNPOTBlockPaddedFormats[] =
+{
+	FName(TEXT("DXT1")), FName(TEXT("DXT3")), FName(TEXT("DXT5")), FName(TEXT("AutoDXT")), FName(TEXT("DXT5n")), FName(TEXT("BC4")), FName(TEXT("BC5")),
+	FName(TEXT("ETC1")), FName(TEXT("AutoETC1a")), FName(TEXT("ETC2_RGB")), FName(TEXT("ETC2_RGBA")), FName(TEXT("AutoETC2")),
+	FName(TEXT("ATC_RGB")), FName(TEXT("ATC_RGBA_E")), FName(TEXT("ATC_RGBA_I")), FName(TEXT("AutoATC"))
+};
+
+/** Formats that accept mips of any size as they are. */
+static const FName GNPOTUnpaddedFormats[] =
+{
+	FName(TEXT("BGRA8")), FName(TEXT("G8")), FName(TEXT("VU8")), FName(TEXT("RGBA16F")), FName(TEXT("XGXR8")), FName(TEXT("RGBA8")),
+	FName(TEXT("BC6H")), FName(TEXT("BC7")),
+	FName(TEXT("ASTC_RGB")), FName(TEXT("ASTC_RGBA")), FName(TEXT("ASTC_RGBAuto")), FName(TEXT("ASTC_NormalAG")), FName(TEXT("ASTC_NormalRG"))
+};
+
+static bool IsNonPowerOfTwo(int32 SizeX, int32 SizeY)
+{
+	return !FMath::IsPowerOfTwo(SizeX) || !FMath::IsPowerOfTwo(SizeY);
+}
+
+static bool WantsMips(const FTextureBuildSettings& BuildSettings)
+{
+	return BuildSettings.MipGenSettings != TMGS_NoMipmaps && BuildSettings.MipGenSettings != TMGS_LeaveExistingMips;
+}
+
+/**
+ * Checks whether the mip chain of a non power of two array can be generated for its texture format.
+ * PVRTC needs square power of two mips and ETC1 has no alpha to hide padding, those arrays stay without mips.
+ */
+static bool CanGenerateNPOTMips(const FTextureBuildSettings& BuildSettings, int32 SizeX, int32 SizeY, bool& bOutPadToBlocks)
+{
+	if ((SizeX % 4) != 0 || (SizeY % 4) != 0)
+	{
+		return false;
+	}
+
+	for (const FName& FormatName : GNPOTBlockPaddedFormats)
+	{
+		if (BuildSettings.TextureFormatName == FormatName)
+		{
+			bOutPadToBlocks = true;
+			return true;
+		}
+	}
+
+	for (const FName& FormatName : GNPOTUnpaddedFormats)
+	{
+		if (BuildSettings.TextureFormatName == FormatName)
+		{
+			bOutPadToBlocks = false;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Derives the settings each slice is built with as a standalone 2D texture from the build settings of the array.
+ * The compressor only builds power of two mip chains, non power of two slices get theirs generated beforehand.
+ */
+static void GetSliceBuildSettings(const FTextureBuildSettings& BuildSettings, int32 SizeX, int32 SizeY, FTextureBuildSettings& OutSliceBuildSettings, bool& bOutGenerateNPOTMips, bool& bOutPadToBlocks)
+{
+	OutSliceBuildSettings = BuildSettings;
+	OutSliceBuildSettings.bTexture2DArray = false;
+
+	bOutGenerateNPOTMips = false;
+	bOutPadToBlocks = false;
+	if (IsNonPowerOfTwo(SizeX, SizeY) && WantsMips(BuildSettings))
+	{
+		bOutGenerateNPOTMips = CanGenerateNPOTMips(BuildSettings, SizeX, SizeY, bOutPadToBlocks);
+		OutSliceBuildSettings.MipGenSettings = bOutGenerateNPOTMips ? TMGS_LeaveExistingMips : TMGS_NoMipmaps;
+	}
+}
+
+/**
+ * Finds the source texels a destination texel covers when box downsampling SrcCount texels to DestCount.
+ * @param OutWeights - Receives the coverage of each of them, summing to 1.
+ * @return the number of covered texels, from OutFirst on.
+ */
+static int32 GetBoxSpan(int32 DestIndex, int32 SrcCount, int32 DestCount, int32& OutFirst, float OutWeights[4])
+{
+	const float Scale = (float)SrcCount / (float)DestCount;
+	const float Start = DestIndex * Scale;
+	const float End = Start + Scale;
+
+	OutFirst = FMath::FloorToInt(Start);
+	const int32 NumTexels = FMath::Min(FMath::CeilToInt(End), SrcCount) - OutFirst;
+	check(NumTexels > 0 && NumTexels <= 4);
+	for (int32 TexelIndex = 0; TexelIndex < NumTexels; ++TexelIndex)
+	{
+		const int32 SrcIndex = OutFirst + TexelIndex;
+		OutWeights[TexelIndex] = (FMath::Min(End, SrcIndex + 1.0f) - FMath::Max(Start, (float)SrcIndex)) / Scale;
+	}
+	return NumTexels;
+}
+
+/** Box downsamples a mip to MipSizeX by MipSizeY, rows then columns, four channels at a time. */
+static void BoxDownsampleMip(const FImage& Mip, int32 MipSizeX, int32 MipSizeY, FImage& OutMip)
+{
+	FImage RowsFiltered(MipSizeX, Mip.SizeY, 1, ERawImageFormat::RGBA32F, EGammaSpace::Linear);
+	for (int32 Y = 0; Y < Mip.SizeY; ++Y)
+	{
+		const FLinearColor* SrcRow = Mip.AsRGBA32F() + Y * Mip.SizeX;
+		FLinearColor* Dest = RowsFiltered.AsRGBA32F() + Y * MipSizeX;
+		for (int32 X = 0; X < MipSizeX; ++X)
+		{
+			int32 FirstX = 0;
+			float Weights[4];
+			const int32 NumTexels = GetBoxSpan(X, Mip.SizeX, MipSizeX, FirstX, Weights);
+			VectorRegister Sum = VectorZero();
+			for (int32 TexelIndex = 0; TexelIndex < NumTexels; ++TexelIndex)
+			{
+				Sum = VectorMultiplyAdd(VectorLoad(SrcRow + FirstX + TexelIndex), VectorSetFloat1(Weights[TexelIndex]), Sum);
+			}
+			VectorStore(Sum, Dest + X);
+		}
+	}
+
+	OutMip = FImage(MipSizeX, MipSizeY, 1, ERawImageFormat::RGBA32F, EGammaSpace::Linear);
+	for (int32 Y = 0; Y < MipSizeY; ++Y)
+	{
+		int32 FirstY = 0;
+		float Weights[4];
+		const int32 NumRows = GetBoxSpan(Y, Mip.SizeY, MipSizeY, FirstY, Weights);
+		const FLinearColor* Src = RowsFiltered.AsRGBA32F() + FirstY * MipSizeX;
+		FLinearColor* Dest = OutMip.AsRGBA32F() + Y * MipSizeX;
+		for (int32 X = 0; X < MipSizeX; ++X)
+		{
+			VectorRegister Sum = VectorZero();
+			for (int32 RowIndex = 0; RowIndex < NumRows; ++RowIndex)
+			{
+				Sum = VectorMultiplyAdd(VectorLoad(Src + RowIndex * MipSizeX + X), VectorSetFloat1(Weights[RowIndex]), Sum);
+			}
+			VectorStore(Sum, Dest + X);
+		}
+	}
+}
+
+/** Blurs a mip with a separable [1 2 1] kernel, clamping at its borders. */
+static void BlurMip(const FImage& Mip, FImage& OutMip)
+{
+	const VectorRegister Quarter = VectorSetFloat1(0.25f);
+	const VectorRegister Half = VectorSetFloat1(0.5f);
+
+	FImage RowsBlurred(Mip.SizeX, Mip.SizeY, 1, ERawImageFormat::RGBA32F, EGammaSpace::Linear);
+	for (int32 Y = 0; Y < Mip.SizeY; ++Y)
+	{
+		const FLinearColor* Src = Mip.AsRGBA32F() + Y * Mip.SizeX;
+		FLinearColor* Dest = RowsBlurred.AsRGBA32F() + Y * Mip.SizeX;
+		for (int32 X = 0; X < Mip.SizeX; ++X)
+		{
+			const VectorRegister Left = VectorLoad(Src + FMath::Max(X - 1, 0));
+			const VectorRegister Right = VectorLoad(Src + FMath::Min(X + 1, Mip.SizeX - 1));
+			VectorStore(VectorMultiplyAdd(VectorLoad(Src + X), Half, VectorMultiply(VectorAdd(Left, Right), Quarter)), Dest + X);
+		}
+	}
+
+	OutMip = FImage(Mip.SizeX, Mip.SizeY, 1, ERawImageFormat::RGBA32F, EGammaSpace::Linear);
+	for (int32 Y = 0; Y < Mip.SizeY; ++Y)
+	{
+		const FLinearColor* Above = RowsBlurred.AsRGBA32F() + FMath::Max(Y - 1, 0) * Mip.SizeX;
+		const FLinearColor* Row = RowsBlurred.AsRGBA32F() + Y * Mip.SizeX;
+		const FLinearColor* Below = RowsBlurred.AsRGBA32F() + FMath::Min(Y + 1, Mip.SizeY - 1) * Mip.SizeX;
+		FLinearColor* Dest = OutMip.AsRGBA32F() + Y * Mip.SizeX;
+		for (int32 X = 0; X < Mip.SizeX; ++X)
+		{
+			VectorStore(VectorMultiplyAdd(VectorLoad(Row + X), Half, VectorMultiply(VectorAdd(VectorLoad(Above + X), VectorLoad(Below + X)), Quarter)), Dest + X);
+		}
+	}
+}
+
+/**
+ * Applies the mip sharpening or blurring of the build settings to a downsampled mip, as an unsharp mask over a blur
+ * as wide as SharpenMipKernelSize. Sharpening without color shift only sharpens the luminance of the color channels.
+ */
+static void ApplyMipKernel(FImage& Mip, const FTextureBuildSettings& BuildSettings)
+{
+	const float Sharpening = BuildSettings.MipSharpening;
+	if (Sharpening == 0.0f)
+	{
+		return;
+	}
+
+	FImage Blurred;
+	BlurMip(Mip, Blurred);
+	const int32 NumBlurPasses = FMath::Max<int32>(BuildSettings.SharpenMipKernelSize / 2 - 1, 1);
+	for (int32 PassIndex = 1; PassIndex < NumBlurPasses; ++PassIndex)
+	{
+		FImage Source = MoveTemp(Blurred);
+		BlurMip(Source, Blurred);
+	}
+
+	if (Sharpening < 0.0f)
+	{
+		Mip = MoveTemp(Blurred);
+		return;
+	}
+
+	const VectorRegister Amount = VectorSetFloat1(Sharpening);
+	const VectorRegister LuminanceWeights = MakeVectorRegister(0.3f, 0.59f, 0.11f, 0.0f);
+	const VectorRegister ColorMask = MakeVectorRegister(1.0f, 1.0f, 1.0f, 0.0f);
+	const VectorRegister AlphaMask = MakeVectorRegister(0.0f, 0.0f, 0.0f, 1.0f);
+
+	FLinearColor* Colors = Mip.AsRGBA32F();
+	const FLinearColor* BlurredColors = Blurred.AsRGBA32F();
+	const int32 NumTexels = Mip.SizeX * Mip.SizeY;
+	for (int32 TexelIndex = 0; TexelIndex < NumTexels; ++TexelIndex)
+	{
+		const VectorRegister Color = VectorLoad(Colors + TexelIndex);
+		VectorRegister Detail = VectorSubtract(Color, VectorLoad(BlurredColors + TexelIndex));
+		if (BuildSettings.bSharpenWithoutColorShift)
+		{
+			Detail = VectorMultiplyAdd(VectorDot3(Detail, LuminanceWeights), ColorMask, VectorMultiply(Detail, AlphaMask));
+		}
+		VectorStore(VectorMultiplyAdd(Detail, Amount, Color), Colors + TexelIndex);
+	}
+}
+
+/** Adds a copy of a mip to OutMips, optionally padded to whole 4x4 blocks by repeating its last column and row. */
+static void AddNPOTMip(const FImage& Mip, bool bPadToBlocks, TArray<FImage>& OutMips)
+{
+	const int32 PaddedSizeX = bPadToBlocks ? Align(Mip.SizeX, 4) : Mip.SizeX;
+	const int32 PaddedSizeY = bPadToBlocks ? Align(Mip.SizeY, 4) : Mip.SizeY;
+
+	FImage* OutMip = new(OutMips) FImage(PaddedSizeX, PaddedSizeY, 1, ERawImageFormat::RGBA32F, EGammaSpace::Linear);
+	const FLinearColor* SrcColors = Mip.AsRGBA32F();
+	FLinearColor* DestColors = OutMip->AsRGBA32F();
+
+	for (int32 Y = 0; Y < PaddedSizeY; ++Y)
+	{
+		const FLinearColor* SrcRow = SrcColors + FMath::Min(Y, Mip.SizeY - 1) * Mip.SizeX;
+		FLinearColor* DestRow = DestColors + Y * PaddedSizeX;
+		FMemory::Memcpy(DestRow, SrcRow, Mip.SizeX * sizeof(FLinearColor));
+		for (int32 X = Mip.SizeX; X < PaddedSizeX; ++X)
+		{
+			DestRow[X] = SrcRow[Mip.SizeX - 1];
+		}
+	}
+}
+
+/**
+ * Generates the full mip chain of a non power of two slice, each mip size rounding down.
+ * Mips are box downsampled, then sharpened or blurred as set by MipSharpening and SharpenMipKernelSize.
+ * With bDownsampleWithAverage the next mip is downsampled from the unsharpened one.
+ */
+static void GenerateNPOTSliceMips(const FImage& SliceMip, const FTextureBuildSettings& BuildSettings, bool bPadToBlocks, TArray<FImage>& OutMips)
+{
+	FImage Mip;
+	SliceMip.CopyTo(Mip, ERawImageFormat::RGBA32F, EGammaSpace::Linear);
+	AddNPOTMip(Mip, bPadToBlocks, OutMips);
+
+	while (Mip.SizeX > 1 || Mip.SizeY > 1)
+	{
+		FImage NextMip;
+		BoxDownsampleMip(Mip, FMath::Max(Mip.SizeX >> 1, 1), FMath::Max(Mip.SizeY >> 1, 1), NextMip);
+
+		if (BuildSettings.MipSharpening != 0.0f)
+		{
+			FImage FilteredMip = NextMip;
+			ApplyMipKernel(FilteredMip, BuildSettings);
+			AddNPOTMip(FilteredMip, bPadToBlocks, OutMips);
+			Mip = BuildSettings.bDownsampleWithAverage ? MoveTemp(NextMip) : MoveTemp(FilteredMip);
+		}
+		else
+		{
+			Mip = MoveTemp(NextMip);
+			AddNPOTMip(Mip, bPadToBlocks, OutMips);
+		}
+	}
+}
+
+/** Whether two compressed slices have the same format and mip chain, so they can be merged in one array. */
+static bool DoSliceMipsMatch(const TArray<FCompressedImage2D>& SliceMips, const TArray<FCompressedImage2D>& OtherSliceMips)
+{
+	if (SliceMips.Num() != OtherSliceMips.Num())
+	{
+		return false;
+	}
+
+	for (int32 MipIndex = 0; MipIndex < SliceMips.Num(); ++MipIndex)
+	{
+		const FCompressedImage2D& Mip = SliceMips[MipIndex];
+		const FCompressedImage2D& OtherMip = OtherSliceMips[MipIndex];
+		if (Mip.SizeX != OtherMip.SizeX || Mip.SizeY != OtherMip.SizeY || Mip.PixelFormat != OtherMip.PixelFormat || Mip.RawData.Num() != OtherMip.RawData.Num())
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Compresses one slice of the array source as a regular 2D texture.
+ * When bGenerateNPOTMips is set the slice mip chain is generated here and handed to the compressor as existing mips.
+ * Mips padded to whole blocks keep their logical size, only their payload covers the padding.
+ */
+static bool CompressSlice(
+	ITextureCompressorModule* Compressor,
+	const TArray<FImage>& SourceMips,
+	int32 SliceIndex,
+	const FTextureBuildSettings& SliceBuildSettings,
+	bool bGenerateNPOTMips,
+	bool bPadToBlocks,
+	TArray<FCompressedImage2D>& OutSliceMips
+	)
+{
+	TArray<FImage> SliceSourceMips;
+	SliceSourceMips.Reserve(SourceMips.Num());
+	for (const FImage& SourceMip : SourceMips)
+	{
+		FImage* SliceMip = new(SliceSourceMips) FImage(SourceMip.SizeX, SourceMip.SizeY, 1, SourceMip.Format, SourceMip.GammaSpace);
+		const int32 SliceSize = SliceMip->RawData.Num();
+		FMemory::Memcpy(SliceMip->RawData.GetData(), SourceMip.RawData.GetData() + SliceIndex * SliceSize, SliceSize);
+	}
+
+	const int32 TopMipSizeX = SliceSourceMips[0].SizeX;
+	const int32 TopMipSizeY = SliceSourceMips[0].SizeY;
+	if (bGenerateNPOTMips)
+	{
+		TArray<FImage> GeneratedMips;
+		GenerateNPOTSliceMips(SliceSourceMips[0], SliceBuildSettings, bPadToBlocks, GeneratedMips);
+		SliceSourceMips = MoveTemp(GeneratedMips);
+	}
+
+	TArray<FImage> EmptyCompositeMips;
+	if (!Compressor->BuildTexture(SliceSourceMips, EmptyCompositeMips, SliceBuildSettings, OutSliceMips) || OutSliceMips.Num() == 0)
+	{
+		return false;
+	}
+
+	if (bGenerateNPOTMips && bPadToBlocks)
+	{
+		// Block compressors report small mips as 4 texels wide and high whatever their size, as they do for power of two textures.
+		const int32 FirstMipIndex = SliceSourceMips.Num() - OutSliceMips.Num();
+		for (int32 MipIndex = 0; MipIndex < OutSliceMips.Num(); ++MipIndex)
+		{
+			FCompressedImage2D& SliceMip = OutSliceMips[MipIndex];
+			SliceMip.SizeX = FMath::Min(SliceMip.SizeX, FMath::Max(TopMipSizeX >> (FirstMipIndex + MipIndex), 4));
+			SliceMip.SizeY = FMath::Min(SliceMip.SizeY, FMath::Max(TopMipSizeY >> (FirstMipIndex + MipIndex), 4));
+		}
+	}
+	return true;
+}
+
+bool BuildTexture2DArrayFromSlices(
+	ITextureCompressorModule* Compressor,
+	const UTexture2DArray& Texture,
+	const TArray<FImage>& SourceMips,
+	const FTextureBuildSettings& BuildSettings,
+	const TArray<FString>& SliceTextureKeys,
+	TArray<FCompressedImage2D>& OutCompressedMips
+	)
+{
+	const int32 NumSlices = SourceMips.Num() ? SourceMips[0].NumSlices : 0;
+	if (NumSlices < 1 || Texture.SourceSliceIds.Num() != NumSlices || !HasSliceIds(Texture))
+	{
+		return false;
+	}
+
+	// Each slice is built as a standalone 2D texture, the array layout is only restored when assembling the mips.
+	FTextureBuildSettings SliceBuildSettings;
+	bool bGenerateNPOTMips = false;
+	bool bPadToBlocks = false;
+	GetSliceBuildSettings(BuildSettings, SourceMips[0].SizeX, SourceMips[0].SizeY, SliceBuildSettings, bGenerateNPOTMips, bPadToBlocks);
+
+	// Slices are keyed by their content, identical slices of any array share their compressed data.
+	TArray<FString> SliceHashes;
+	SliceHashes.SetNum(NumSlices);
+	ParallelFor(NumSlices, [&](int32 SliceIndex)
+	{
+		SliceHashes[SliceIndex] = CalcSliceContentHash(SourceMips, SliceIndex);
+	});
+
+	// Stored for cooks finding the array in the DDC, they record its slices without hashing the source again.
+	{
+		TArray<uint8> RawSliceHashes;
+		FMemoryWriter Ar(RawSliceHashes, /*bIsPersistent=*/ true);
+		Ar << SliceHashes;
+		GetDerivedDataCacheRef().Put(*GetSliceHashesDerivedDataKey(Texture, SourceMips.Num(), SourceMips[0].GammaSpace), RawSliceHashes);
+	}
+	FTexture2DArraySliceIndex::Get().SetArraySlices(Texture.GetPathName(), SliceHashes);
+
+	// Keys are computed up front, looking up the texture format is not thread safe.
+	TArray<FString> SliceKeys;
+	SliceKeys.SetNum(NumSlices);
+	for (int32 SliceIndex = 0; SliceIndex < NumSlices; ++SliceIndex)
+	{
+		GetTexture2DArraySliceDerivedDataKey(Texture, SliceHashes[SliceIndex], BuildSettings, SliceKeys[SliceIndex]);
+	}
+
+	// Slices repeated in the array are only fetched or compressed once.
+	TArray<int32> UniqueSlices;
+	TArray<int32> SliceOrigins;
+	SliceOrigins.SetNum(NumSlices);
+	{
+		TMap<FString, int32> FirstSliceIndices;
+		for (int32 SliceIndex = 0; SliceIndex < NumSlices; ++SliceIndex)
+		{
+			const int32* FirstSliceIndex = FirstSliceIndices.Find(SliceKeys[SliceIndex]);
+			if (FirstSliceIndex)
+			{
+				SliceOrigins[SliceIndex] = *FirstSliceIndex;
+			}
+			else
+			{
+				FirstSliceIndices.Add(SliceKeys[SliceIndex], SliceIndex);
+				SliceOrigins[SliceIndex] = SliceIndex;
+				UniqueSlices.Add(SliceIndex);
+			}
+		}
+	}
+
+	// Keys computed for another source are ignored rather than reusing the wrong slice textures.
+	const bool bReuseSliceTextures = SliceTextureKeys.Num() == NumSlices;
+
+	// Slices missing from the DDC are built in parallel, each generating its own mip chain before compressing it.
+	TArray<TArray<FCompressedImage2D>> CompressedSlices;
+	CompressedSlices.SetNum(NumSlices);
+	FThreadSafeCounter NumSlicesBuilt;
+	FThreadSafeCounter NumSlicesReused;
+	FThreadSafeCounter NumSlicesFailed;
+
+	auto BuildSlice = [&](int32 SliceIndex)
+	{
+		TArray<FCompressedImage2D>& SliceMips = CompressedSlices[SliceIndex];
+		if (!CompressSlice(Compressor, SourceMips, SliceIndex, SliceBuildSettings, bGenerateNPOTMips, bPadToBlocks, SliceMips))
+		{
+			UE_LOG(LogTexture, Warning, TEXT("Failed to build slice %d of %s."), SliceIndex, *Texture.GetPathName());
+			NumSlicesFailed.Increment();
+			return;
+		}
+
+		TArray<uint8> RawSliceData;
+		FMemoryWriter Ar(RawSliceData, /*bIsPersistent=*/ true);
+		SerializeCompressedSlice(Ar, SliceMips);
+		GetDerivedDataCacheRef().Put(*SliceKeys[SliceIndex], RawSliceData);
+		NumSlicesBuilt.Increment();
+	};
+
+	// Slices with a slice texture are only built once the ones from the DDC or compressed here tell the format and mip chain to expect.
+	TArray<int32> SliceTextureSlices;
+	FCriticalSection SliceTextureSlicesCS;
+	ParallelFor(UniqueSlices.Num(), [&](int32 UniqueIndex)
+	{
+		const int32 SliceIndex = UniqueSlices[UniqueIndex];
+		TArray<uint8> RawSliceData;
+		if (GetDerivedDataCacheRef().GetSynchronous(*SliceKeys[SliceIndex], RawSliceData))
+		{
+			FMemoryReader Ar(RawSliceData, /*bIsPersistent=*/ true);
+			SerializeCompressedSlice(Ar, CompressedSlices[SliceIndex]);
+		}
+
+		if (!CompressedSlices[SliceIndex].Num())
+		{
+			if (bReuseSliceTextures && !SliceTextureKeys[SliceIndex].IsEmpty())
+			{
+				FScopeLock Lock(&SliceTextureSlicesCS);
+				SliceTextureSlices.Add(SliceIndex);
+			}
+			else
+			{
+				BuildSlice(SliceIndex);
+			}
+		}
+	});
+
+	if (SliceTextureSlices.Num() > 0 && NumSlicesFailed.GetValue() == 0)
+	{
+		SliceTextureSlices.Sort();
+		const TArray<FCompressedImage2D>* ExpectedMips = nullptr;
+		for (int32 UniqueSliceIndex : UniqueSlices)
+		{
+			if (CompressedSlices[UniqueSliceIndex].Num())
+			{
+				ExpectedMips = &CompressedSlices[UniqueSliceIndex];
+				break;
+			}
+		}
+		if (!ExpectedMips)
+		{
+			BuildSlice(SliceTextureSlices[0]);
+			ExpectedMips = &CompressedSlices[SliceTextureSlices[0]];
+			SliceTextureSlices.RemoveAt(0);
+		}
+
+		// Slice textures built with other settings, or whose data is truncated, are compressed again.
+		ParallelFor(SliceTextureSlices.Num(), [&](int32 ReuseIndex)
+		{
+			const int32 SliceIndex = SliceTextureSlices[ReuseIndex];
+			TArray<FCompressedImage2D>& SliceMips = CompressedSlices[SliceIndex];
+			if (GetTexture2DArraySliceTextureMips(SliceTextureKeys[SliceIndex], SliceMips))
+			{
+				if (DoSliceMipsMatch(SliceMips, *ExpectedMips))
+				{
+					// Kept under the slice texture key only, the compressed data is not duplicated in the DDC.
+					NumSlicesReused.Increment();
+					return;
+				}
+
+				UE_LOG(LogTexture, Log, TEXT("Slice texture %d of %s has a different format or mip chain than the array builds, it is compressed again."), SliceIndex, *Texture.GetPathName());
+				SliceMips.Empty();
+			}
+			BuildSlice(SliceIndex);
+		});
+	}
+
+	if (NumSlicesFailed.GetValue() > 0)
+	{
+		UE_LOG(LogTexture, Warning, TEXT("Failed to build %d slices of %s, building the whole array instead."), NumSlicesFailed.GetValue(), *Texture.GetPathName());
+		return false;
+	}
+
+	for (int32 SliceIndex = 0; SliceIndex < NumSlices; ++SliceIndex)
+	{
+		if (SliceOrigins[SliceIndex] != SliceIndex)
+		{
+			CompressedSlices[SliceIndex] = CompressedSlices[SliceOrigins[SliceIndex]];
+		}
+	}
+
+	// All slices must share the same mip chain to be merged back into the array layout.
+	const TArray<FCompressedImage2D>& FirstSliceMips = CompressedSlices[0];
+	const int32 NumMips = FirstSliceMips.Num();
+	for (int32 SliceIndex = 1; SliceIndex < NumSlices; ++SliceIndex)
+	{
+		if (!DoSliceMipsMatch(CompressedSlices[SliceIndex], FirstSliceMips))
+		{
+			UE_LOG(LogTexture, Warning, TEXT("Slice %d of %s was compressed to a different format or mip chain than slice 0, building the whole array instead."), SliceIndex, *Texture.GetPathName());
+			return false;
+		}
+	}
+
+	OutCompressedMips.Empty(NumMips);
+	for (int32 MipIndex = 0; MipIndex < NumMips; ++MipIndex)
+	{
+		const FCompressedImage2D& FirstSliceMip = FirstSliceMips[MipIndex];
+
+		FCompressedImage2D* CompressedMip = new(OutCompressedMips) FCompressedImage2D();
+		CompressedMip->SizeX = FirstSliceMip.SizeX;
+		CompressedMip->SizeY = FirstSliceMip.SizeY;
+		CompressedMip->SizeZ = NumSlices;
+		CompressedMip->PixelFormat = FirstSliceMip.PixelFormat;
+		CompressedMip->RawData.Empty(FirstSliceMip.RawData.Num() * NumSlices);
+
+		for (const TArray<FCompressedImage2D>& SliceMips : CompressedSlices)
+		{
+			CompressedMip->RawData.Append(SliceMips[MipIndex].RawData);
+		}
+	}
+
+	UE_LOG(LogTexture, Verbose, TEXT("Built %s from slices: %d compressed, %d from slice textures, %d from the derived data cache, %d repeated."), *Texture.GetPathName(),
+		NumSlicesBuilt.GetValue(), NumSlicesReused.GetValue(), UniqueSlices.Num() - NumSlicesBuilt.GetValue() - NumSlicesReused.GetValue(), NumSlices - UniqueSlices.Num());
+	return true;
+}
+
+void GetTexture2DArraySliceTextureDerivedDataKeys(const UTexture2DArray& Texture, const FTextureBuildSettings& BuildSettings, TArray<FString>& OutKeys)
+{
+	check(IsInGameThread());
+
+	const int32 NumSlices = Texture.Source.GetNumSlices();
+	OutKeys.Empty(NumSlices);
+	OutKeys.SetNum(NumSlices);
+
+	// Their key only covers their top source mip when mips are generated, and the non power of two chains are built per slice only.
+	FTextureBuildSettings SliceBuildSettings;
+	bool bGenerateNPOTMips = false;
+	bool bPadToBlocks = false;
+	GetSliceBuildSettings(BuildSettings, Texture.Source.GetSizeX(), Texture.Source.GetSizeY(), SliceBuildSettings, bGenerateNPOTMips, bPadToBlocks);
+	if (bGenerateNPOTMips || SliceBuildSettings.MipGenSettings == TMGS_LeaveExistingMips || Texture.SourceSliceIds.Num() != NumSlices)
+	{
+		return;
+	}
+
+	for (int32 SliceIndex = 0; SliceIndex < NumSlices; ++SliceIndex)
+	{
+		// A composite texture is applied to the slice texture when built on its own but not to the array slice.
+		const UTexture2D* SliceTexture = Texture.Source2DTextures.IsValidIndex(SliceIndex) ? Texture.Source2DTextures[SliceIndex] : nullptr;
+		const bool bHasComposite = SliceTexture && SliceTexture->CompositeTexture && SliceTexture->CompositeTextureMode != CTM_Disabled;
+		if (SliceTexture && !bHasComposite && SliceTexture->Source.GetId() == Texture.SourceSliceIds[SliceIndex] && SliceTexture->Source.GetNumSlices() == 1)
+		{
+			GetTexture2DArraySliceTextureDerivedDataKey(*SliceTexture, SliceBuildSettings, OutKeys[SliceIndex]);
+		}
+	}
+}
+
+void AdjustTexture2DArraySingleImageBuildSettings(const UTexture& Texture, const TArray<FImage>& SourceMips, FTextureBuildSettings& InOutBuildSettings)
+{
+	if (SourceMips.Num() && IsNonPowerOfTwo(SourceMips[0].SizeX, SourceMips[0].SizeY) && WantsMips(InOutBuildSettings))
+	{
+		bool bPadToBlocks = false;
+		if (CanGenerateNPOTMips(InOutBuildSettings, SourceMips[0].SizeX, SourceMips[0].SizeY, bPadToBlocks))
+		{
+			UE_LOG(LogTexture, Warning, TEXT("%s could not be built slice by slice, it is built without mips."), *Texture.GetPathName());
+		}
+		InOutBuildSettings.MipGenSettings = TMGS_NoMipmaps;
+	}
+}
+
+#endif // WITH_EDITOR
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if WITH_EDITOR
+
+class UTexture;
+class UTexture2DArray;
+class ITextureCompressorModule;
+struct FImage;
+struct FCompressedImage2D;
+struct FTextureBuildSettings;
+
+/**
+ * Computes the derived data key of a single compressed slice of a texture 2D array.
+ * @param Texture - The texture 2D array the slice belongs to.
+ * @param SliceContentHash - Hash of the source content of the slice.
+ * @param BuildSettings - Build settings of the texture 2D array.
+ * @param OutKey - The derived data key of the slice.
+ */
+void GetTexture2DArraySliceDerivedDataKey(const UTexture& Texture, const FString& SliceContentHash, const FTextureBuildSettings& BuildSettings, FString& OutKey);
+
+/**
+ * Computes the derived data key a slice texture has when built on its own with the given settings.
+ * @param SliceTexture - The texture the slice comes from.
+ * @param SliceBuildSettings - Build settings of the slice, as built on its own.
+ * @param OutKey - The derived data key of the slice texture.
+ */
+void GetTexture2DArraySliceTextureDerivedDataKey(const UTexture& SliceTexture, const FTextureBuildSettings& SliceBuildSettings, FString& OutKey);
+
+/**
+ * Fetches the compressed mips of a texture built on its own from the DDC.
+ * @param DerivedDataKey - Derived data key of the texture.
+ * @param OutMips - The compressed mips, untouched on failure.
+ * @return false if the texture or one of its mips is not in the DDC.
+ */
+bool GetTexture2DArraySliceTextureMips(const FString& DerivedDataKey, TArray<FCompressedImage2D>& OutMips);
+
+/**
+ * Records the slice content hashes of an array being cooked, listed by ListSharedTexture2DArraySlices.
+ * Called for every cooked array, whether its platform data has to be built or is already in the DDC,
+ * arrays built per slice are also recorded by BuildTexture2DArrayFromSlices.
+ * @param Texture - The texture 2D array being cooked.
+ * @param BuildSettings - Build settings of the texture 2D array for the cooked platform.
+ */
+void RecordTexture2DArraySlices(UTexture2DArray& Texture, const FTextureBuildSettings& BuildSettings);
+
+/**
+ * Computes the derived data keys of the slice textures of an array whose DDC data the array slices can reuse.
+ * Must be called on the game thread, it reads Source2DTextures. Slices that can't be reused get an empty key,
+ * such as slice textures with a composite texture, their own build applies it but the array slice build does not.
+ * @param Texture - The texture 2D array.
+ * @param BuildSettings - Build settings of the texture 2D array.
+ * @param OutKeys - One derived data key per slice of the array source.
+ */
+void GetTexture2DArraySliceTextureDerivedDataKeys(const UTexture2DArray& Texture, const FTextureBuildSettings& BuildSettings, TArray<FString>& OutKeys);
+
+/**
+ * Slices missing from it reuse the derived data of their slice texture when its format and mip chain match the ones the array builds.
+ * Slices missing from it reuse the derived data of their slice texture when it was built with the same settings.
+ * @param Compressor - The texture compressor.
+ * @param Texture - The texture 2D array to build.
+ * @param SourceMips - Source mips of the array, slices stored one after another.
+ * @param BuildSettings - Build settings of the texture 2D array.
+ * @param SliceTextureKeys - Keys from GetTexture2DArraySliceTextureDerivedDataKeys, slice textures are not reused if empty.
+ * @param OutCompressedMips - Compressed mips of the whole array, untouched on failure.
+ * @return false if the array can't be built per slice and must be built as a single image.
+ */
+bool BuildTexture2DArrayFromSlices(
+	ITextureCompressorModule* Compressor,
+	const UTexture2DArray& Texture,
+	const TArray<FImage>& SourceMips,
+	const FTextureBuildSettings& BuildSettings,
+	const TArray<FString>& SliceTextureKeys,
+	TArray<FCompressedImage2D>& OutCompressedMips
+	);
+
+/**
+ * Adjusts the build settings of a texture 2D array built as a single image.
+ * Only the per slice build generates non power of two mip chains, such arrays are built without mips here.
+ * @param Texture - The texture 2D array, for logging.
+ * @param SourceMips - Source mips of the array.
+ * @param InOutBuildSettings - Build settings of the texture 2D array.
+ */
+void AdjustTexture2DArraySingleImageBuildSettings(const UTexture& Texture, const TArray<FImage>& SourceMips, FTextureBuildSettings& InOutBuildSettings);
+
+#endif // WITH_EDITOR
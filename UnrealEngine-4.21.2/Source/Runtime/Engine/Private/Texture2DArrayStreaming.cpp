@@ -0,0 +1,272 @@
+#include "Texture2DArrayStreaming.h"
+#include "Engine/Texture2DArray.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "Misc/CoreDelegates.h"
+#include "ContentStreaming.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+#include "UObject/UObjectIterator.h"
+#include "RHI.h"
+
+static TAutoConsoleVariable<float> CVarTexture2DArrayStreamingUnusedTime(
+	TEXT("r.Texture2DArray.Streaming.UnusedTime"),
+	5.0f,
+	TEXT("Seconds after which an array that was not rendered drops its streamed mips."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarTexture2DArrayStreamingMaxPendingRequests(
+	TEXT("r.Texture2DArray.Streaming.MaxPendingRequests"),
+	4,
+	TEXT("Maximum number of texture 2D arrays loading mips at the same time."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarTexture2DArrayStreamingPoolSize(
+	TEXT("r.Texture2DArray.Streaming.PoolSize"),
+	0,
+	TEXT("Memory budget of texture 2D arrays in MB, the least important arrays drop their top mips to fit in it.\n")
+	TEXT("0 keeps arrays within what is left of the texture pool when it is limited, -1 disables the budget."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarTexture2DArrayStreamingScreenSizeInterval(
+	TEXT("r.Texture2DArray.Streaming.ScreenSizeInterval"),
+	1.0f,
+	TEXT("Seconds between two updates of the screen size of arrays while they are over budget.\n")
+	TEXT("The screen size of an array is found from the materials of the primitives rendered recently."),
+	ECVF_Default);
+
+/** Textures whose wanted mips can be lowered to fit in the budget. */
+struct FTexture2DArrayBudgetEntry
+{
+	UTexture2DArray* Texture;
+	int32 MinResidentMips;
+	float Importance;
+};
+
+FTexture2DArrayStreamingManager& FTexture2DArrayStreamingManager::Get()
+{
+	static FTexture2DArrayStreamingManager Manager;
+	return Manager;
+}
+
+FTexture2DArrayStreamingManager::FTexture2DArrayStreamingManager()
+	: LastScreenSizeUpdateTime(-FLT_MAX)
+{
+	TickHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FTexture2DArrayStreamingManager::Tick));
+	FCoreDelegates::OnPreExit.AddRaw(this, &FTexture2DArrayStreamingManager::Shutdown);
+}
+
+FTexture2DArrayStreamingManager::~FTexture2DArrayStreamingManager()
+{
+}
+
+void FTexture2DArrayStreamingManager::Shutdown()
+{
+	FCoreDelegates::OnPreExit.RemoveAll(this);
+	if (TickHandle.IsValid())
+	{
+		FTicker::GetCoreTicker().RemoveTicker(TickHandle);
+		TickHandle.Reset();
+	}
+	Textures.Empty();
+	ScreenSizes.Empty();
+}
+
+void FTexture2DArrayStreamingManager::AddTexture(UTexture2DArray* Texture)
+{
+	check(IsInGameThread());
+	Textures.AddUnique(Texture);
+}
+
+void FTexture2DArrayStreamingManager::RemoveTexture(UTexture2DArray* Texture)
+{
+	check(IsInGameThread());
+	Textures.RemoveSwap(Texture);
+	ScreenSizes.Remove(Texture);
+}
+
+bool FTexture2DArrayStreamingManager::Tick(float DeltaTime)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_Texture2DArrayStreamingManager_Tick);
+
+	const double CurrentTime = FApp::GetCurrentTime();
+	const float UnusedTime = CVarTexture2DArrayStreamingUnusedTime.GetValueOnGameThread();
+	const int32 MaxPendingRequests = CVarTexture2DArrayStreamingMaxPendingRequests.GetValueOnGameThread();
+
+	int32 NumPendingRequests = 0;
+	for (UTexture2DArray* Texture : Textures)
+	{
+		if (Texture->UpdateStreamingStatus())
+		{
+			++NumPendingRequests;
+		}
+	}
+
+	TArray<FTexture2DArrayBudgetEntry> BudgetEntries;
+	TArray<int32> MinResidentMipsPerTexture;
+	MinResidentMipsPerTexture.AddUninitialized(Textures.Num());
+	int64 ResidentSize = 0;
+	int64 WantedSize = 0;
+	for (int32 TextureIndex = 0; TextureIndex < Textures.Num(); ++TextureIndex)
+	{
+		// Rendered arrays want every mip allowed by their LOD bias, the others only keep what can't be streamed.
+		// Arrays that are not streamed always want all of them, they count against the budget but are never reduced.
+		UTexture2DArray* Texture = Textures[TextureIndex];
+		const int32 NumMips = Texture->GetNumMips();
+		const int32 MaxResidentMips = FMath::Clamp(NumMips - Texture->GetCachedLODBias(), 1, NumMips);
+		const int32 MinResidentMips = Texture->IsStreamable() ? FMath::Clamp(Texture->GetNumNonStreamingMips(), 1, MaxResidentMips) : MaxResidentMips;
+		const bool bRecentlyRendered = CurrentTime - Texture->GetLastRenderTimeForStreaming() <= UnusedTime;
+		MinResidentMipsPerTexture[TextureIndex] = MinResidentMips;
+
+		Texture->WantedMips = bRecentlyRendered ? MaxResidentMips : MinResidentMips;
+
+		ResidentSize += Texture->CalcTextureMemorySize(Texture->GetNumResidentMips());
+		WantedSize += Texture->CalcTextureMemorySize(Texture->WantedMips);
+		if (Texture->WantedMips > MinResidentMips)
+		{
+			FTexture2DArrayBudgetEntry& Entry = BudgetEntries[BudgetEntries.AddUninitialized()];
+			Entry.Texture = Texture;
+			Entry.MinResidentMips = MinResidentMips;
+			Entry.Importance = 0.0f;
+		}
+	}
+
+	// Drop the top mips of the arrays that are the smallest on screen until the wanted mips fit in the budget.
+	const int64 Budget = CalcBudget(ResidentSize);
+	if (WantedSize > Budget)
+	{
+		if (CurrentTime - LastScreenSizeUpdateTime >= CVarTexture2DArrayStreamingScreenSizeInterval.GetValueOnGameThread())
+		{
+			UpdateScreenSizes(UnusedTime);
+			LastScreenSizeUpdateTime = CurrentTime;
+		}
+
+		// Arrays rendered without a primitive using them, e.g. by UI or post process materials, rank in the middle of the others.
+		float TotalScreenSize = 0.0f;
+		int32 NumScreenSizes = 0;
+		for (FTexture2DArrayBudgetEntry& Entry : BudgetEntries)
+		{
+			if (const float* ScreenSize = ScreenSizes.Find(Entry.Texture))
+			{
+				Entry.Importance = *ScreenSize;
+				TotalScreenSize += *ScreenSize;
+				++NumScreenSizes;
+			}
+			else
+			{
+				Entry.Importance = -1.0f;
+			}
+		}
+		const float NeutralImportance = NumScreenSizes > 0 ? TotalScreenSize / NumScreenSizes : 0.0f;
+		for (FTexture2DArrayBudgetEntry& Entry : BudgetEntries)
+		{
+			if (Entry.Importance < 0.0f)
+			{
+				Entry.Importance = NeutralImportance;
+			}
+		}
+
+		BudgetEntries.Sort([](const FTexture2DArrayBudgetEntry& A, const FTexture2DArrayBudgetEntry& B) { return A.Importance < B.Importance; });
+		for (const FTexture2DArrayBudgetEntry& Entry : BudgetEntries)
+		{
+			UTexture2DArray* Texture = Entry.Texture;
+			while (WantedSize > Budget && Texture->WantedMips > Entry.MinResidentMips)
+			{
+				WantedSize -= Texture->CalcTextureMemorySize(Texture->WantedMips) - Texture->CalcTextureMemorySize(Texture->WantedMips - 1);
+				--Texture->WantedMips;
+			}
+		}
+	}
+
+	// Arrays missing mips they can't do without, such as arrays still showing their placeholder, are loaded first.
+	for (int32 Pass = 0; Pass < 2 && NumPendingRequests < MaxPendingRequests; ++Pass)
+	{
+		for (int32 TextureIndex = 0; TextureIndex < Textures.Num() && NumPendingRequests < MaxPendingRequests; ++TextureIndex)
+		{
+			UTexture2DArray* Texture = Textures[TextureIndex];
+			const bool bBelowMinResidentMips = Texture->GetNumResidentMips() < MinResidentMipsPerTexture[TextureIndex];
+			if (bBelowMinResidentMips == (Pass == 0) && Texture->WantedMips != Texture->GetNumResidentMips() && Texture->StreamMips(Texture->WantedMips))
+			{
+				++NumPendingRequests;
+			}
+		}
+	}
+
+	return true;
+}
+
+int64 FTexture2DArrayStreamingManager::CalcBudget(int64 ResidentSize) const
+{
+	const int32 PoolSizeMB = CVarTexture2DArrayStreamingPoolSize.GetValueOnGameThread();
+	if (PoolSizeMB > 0)
+	{
+		return (int64)PoolSizeMB * 1024 * 1024;
+	}
+
+	if (PoolSizeMB == 0)
+	{
+		// Arrays can keep what they have plus what is left in the pool, or have to give back what the pool is over by.
+		FTextureMemoryStats Stats;
+		RHIGetTextureMemoryStats(Stats);
+		if (Stats.IsUsingLimitedPoolSize())
+		{
+			return FMath::Max<int64>(ResidentSize + Stats.TexturePoolSize - Stats.AllocatedMemorySize, 0);
+		}
+	}
+
+	return MAX_int64;
+}
+
+void FTexture2DArrayStreamingManager::UpdateScreenSizes(float UnusedTime)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_Texture2DArrayStreamingManager_UpdateScreenSizes);
+
+	ScreenSizes.Reset();
+
+	IStreamingManager& StreamingManager = IStreamingManager::Get();
+	float MaxViewScreenSize = 1.0f;
+	for (int32 ViewIndex = 0; ViewIndex < StreamingManager.GetNumViews(); ++ViewIndex)
+	{
+		MaxViewScreenSize = FMath::Max(MaxViewScreenSize, StreamingManager.GetViewInformation(ViewIndex).ScreenSize);
+	}
+
+	// Each array gets the largest screen size in pixels of the recently rendered primitives whose materials use it.
+	TArray<UTexture*> UsedTextures;
+	for (TObjectIterator<UPrimitiveComponent> It; It; ++It)
+	{
+		UPrimitiveComponent* Component = *It;
+		const UWorld* World = Component->GetWorld();
+		if (!Component->IsRegistered() || Component->IsPendingKill() || !World || World->GetTimeSeconds() - Component->LastRenderTimeOnScreen > UnusedTime)
+		{
+			continue;
+		}
+
+		UsedTextures.Reset();
+		Component->GetUsedTextures(UsedTextures, EMaterialQualityLevel::Num);
+
+		float ScreenSize = -1.0f;
+		for (UTexture* UsedTexture : UsedTextures)
+		{
+			const UTexture2DArray* Texture = Cast<UTexture2DArray>(UsedTexture);
+			if (!Texture)
+			{
+				continue;
+			}
+
+			if (ScreenSize < 0.0f)
+			{
+				ScreenSize = 0.0f;
+				const FBoxSphereBounds& Bounds = Component->Bounds;
+				for (int32 ViewIndex = 0; ViewIndex < StreamingManager.GetNumViews(); ++ViewIndex)
+				{
+					const FStreamingViewInfo& ViewInfo = StreamingManager.GetViewInformation(ViewIndex);
+					const float Distance = FMath::Max(FVector::Dist(ViewInfo.ViewOrigin, Bounds.Origin) - Bounds.SphereRadius, 1.0f);
+					ScreenSize = FMath::Max(ScreenSize, FMath::Min(Bounds.SphereRadius * ViewInfo.FOVScreenSize / Distance, MaxViewScreenSize));
+				}
+			}
+
+			float& TextureScreenSize = ScreenSizes.FindOrAdd(Texture);
+			TextureScreenSize = FMath::Max(TextureScreenSize, ScreenSize);
+		}
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+
+class UTexture2DArray;
+
+/**
+ * Streams the top mips of texture 2D arrays in and out, the texture streamer only handles UTexture2D.
+ * Every array starts with a small placeholder and gets its mips loaded from here, including arrays that are not streamed.
+ * Arrays that were not rendered for a while drop to their non streaming mips and get the rest back once rendered again.
+ * When arrays go over their memory budget, the ones that are the smallest on screen drop their top mips until they fit.
+ * Their screen size is found from the materials of the rendered primitives, only while over budget and at most once per
+ * r.Texture2DArray.Streaming.ScreenSizeInterval seconds. Arrays that are not streamed count against the budget but keep all of their mips.
+ */
+class FTexture2DArrayStreamingManager
+{
+public:
+	static FTexture2DArrayStreamingManager& Get();
+
+	/** Starts loading and streaming the mips of a texture, does nothing if it is already registered. */
+	void AddTexture(UTexture2DArray* Texture);
+
+	/** Stops streaming the mips of a texture, its resident mips are left as they are. */
+	void RemoveTexture(UTexture2DArray* Texture);
+
+	/** Number of textures currently registered. */
+	int32 GetNumTextures() const { return Textures.Num(); }
+
+private:
+	FTexture2DArrayStreamingManager();
+	~FTexture2DArrayStreamingManager();
+
+	/** Unregisters the ticker before exit, the core ticker may be gone by the time static objects are destroyed. */
+	void Shutdown();
+
+	/** Updates the wanted mips of every streamed texture and issues the streaming requests. */
+	bool Tick(float DeltaTime);
+
+	/** Memory the streamed textures may use, given the size of their resident mips. */
+	int64 CalcBudget(int64 ResidentSize) const;
+
+	/**
+	 * Finds the screen size of the arrays used by the materials of the recently rendered primitives.
+	 * The arrays with the smallest one drop their mips first. Walks every primitive component, only called while over budget.
+	 */
+	void UpdateScreenSizes(float UnusedTime);
+
+	/** Textures whose mips are loaded and streamed. */
+	TArray<UTexture2DArray*> Textures;
+
+	/** Largest screen size in pixels of the primitives using each array, as of the last UpdateScreenSizes. */
+	TMap<const UTexture2DArray*, float> ScreenSizes;
+
+	/** When UpdateScreenSizes last ran. */
+	double LastScreenSizeUpdateTime;
+
+	FDelegateHandle TickHandle;
+};
@@ -24,6 +24,7 @@
 #include "Streaming/TextureStreamingHelpers.h"
 #include "Engine/VolumeTexture.h"
 #include "Engine/Texture2DArray.h" // FB Bulgakov - Texture2D Array
+#include "Texture2DArrayDerivedData.h" // FB Bulgakov - Texture2D Array
 
 #if WITH_EDITOR
 
@@ -46,6 +47,11 @@
 
 #define TEXTURE_DERIVEDDATA_VER		TEXT("68A083899C6F4316B8CE0E2958EDE2C2")
 
+// FB Bulgakov Begin - Texture2D Array
+// Version of the per-slice derived data of texture 2D arrays, replace with a new guid when the slice data changes
+#define TEXTURE2DARRAY_SLICE_DERIVEDDATA_VER		TEXT("4BA3808484954599AD9A449877BB144F")
+// FB Bulgakov End
+
 #if ENABLE_COOK_STATS
 namespace TextureCookStats
 {
@@ -168,6 +174,15 @@ static void SerializeForKey(FArchive& Ar, const FTextureBuildSettings& Settings)
 		(TextureFormat == NULL) ? TEXT("") : *TextureFormat->GetDerivedDataKeyString(Texture)
 		);
 
+	// FB Bulgakov Begin - Texture2D Array
+	// Arrays are assembled from their slice data and are rebuilt when its format changes.
+	if (BuildSettings.bTexture2DArray)
+	{
+		OutKeySuffix += TEXT("_");
+		OutKeySuffix += TEXTURE2DARRAY_SLICE_DERIVEDDATA_VER;
+	}
+	// FB Bulgakov End
+
 	// Serialize the compressor settings into a temporary array. The archive
 	// is flagged as persistent so that machines of different endianness produce
 	// identical binary results.
@@ -185,6 +200,49 @@ static void SerializeForKey(FArchive& Ar, const FTextureBuildSettings& Settings)
 	}
 }
 
+// FB Bulgakov Begin - Texture2D Array
+void GetTexture2DArraySliceDerivedDataKey(const UTexture& Texture, const FString& SliceContentHash, const FTextureBuildSettings& BuildSettings, FString& OutKey)
+{
+	uint16 Version = 0;
+
+	ITargetPlatformManagerModule* TPM = GetTargetPlatformManager();
+	const ITextureFormat* TextureFormat = NULL;
+	if (TPM)
+	{
+		TextureFormat = TPM->FindTextureFormat(BuildSettings.TextureFormatName);
+		if (TextureFormat)
+		{
+			Version = TextureFormat->GetVersion(BuildSettings.TextureFormatName, &BuildSettings);
+		}
+	}
+
+	// The slice is keyed by its content and the array build settings, so arrays sharing a slice share its derived data.
+	FString KeySuffix = FString::Printf(TEXT("%s_%d_%s_%s"),
+		*BuildSettings.TextureFormatName.GetPlainNameString(),
+		Version,
+		*SliceContentHash,
+		(TextureFormat == NULL) ? TEXT("") : *TextureFormat->GetDerivedDataKeyString(Texture)
+		);
+
+	TArray<uint8> TempBytes;
+	TempBytes.Reserve(64);
+	FMemoryWriter Ar(TempBytes, /*bIsPersistent=*/ true);
+	SerializeForKey(Ar, BuildSettings);
+
+	KeySuffix.Reserve(KeySuffix.Len() + TempBytes.Num() * 2);
+	for (int32 ByteIndex = 0; ByteIndex < TempBytes.Num(); ++ByteIndex)
+	{
+		ByteToHex(TempBytes[ByteIndex], KeySuffix);
+	}
+
+	OutKey = FDerivedDataCacheInterface::BuildCacheKey(
+		TEXT("TEXTURE2DARRAYSLICE"),
+		TEXTURE2DARRAY_SLICE_DERIVEDDATA_VER,
+		*KeySuffix
+		);
+}
+// FB Bulgakov End
+
 /**
  * Constructs a derived data key from the key suffix.
  * @param KeySuffix - The key suffix.
@@ -236,6 +294,103 @@ static void GetTextureDerivedDataKey(
 	GetTextureDerivedDataKeyFromSuffix(KeySuffix, OutKey);
 }
 
+// FB Bulgakov Begin - Texture2D Array
+void GetTexture2DArraySliceTextureDerivedDataKey(const UTexture& SliceTexture, const FTextureBuildSettings& SliceBuildSettings, FString& OutKey)
+{
+	// The same key the slice texture gets when built on its own with these settings.
+	GetTextureDerivedDataKey(SliceTexture, SliceBuildSettings, OutKey);
+}
+
+/**
+ * Reads a mip of a texture built on its own, from its own DDC key when it is streamed.
+ * @param OutData - Receives the mip data as stored, whatever its size.
+ * @return false if the mip has no data.
+ */
+static bool LoadTexture2DArraySliceTextureMip(FTexture2DMipMap& Mip, TArray<uint8>& OutData)
+{
+	if (!Mip.DerivedDataKey.IsEmpty())
+	{
+		TArray<uint8> DerivedData;
+		if (!GetDerivedDataCacheRef().GetSynchronous(*Mip.DerivedDataKey, DerivedData))
+		{
+			return false;
+		}
+
+		int32 MipSize = 0;
+		FMemoryReader Ar(DerivedData, /*bIsPersistent=*/ true);
+		Ar << MipSize;
+		if (MipSize <= 0 || MipSize > Ar.TotalSize() - Ar.Tell())
+		{
+			return false;
+		}
+		OutData.SetNumUninitialized(MipSize);
+		Ar.Serialize(OutData.GetData(), MipSize);
+		return true;
+	}
+
+	const int32 MipSize = Mip.BulkData.GetBulkDataSize();
+	if (MipSize <= 0)
+	{
+		return false;
+	}
+	// GetCopy copies into the buffer it is given when it is not null.
+	OutData.SetNumUninitialized(MipSize);
+	void* MipData = OutData.GetData();
+	Mip.BulkData.GetCopy(&MipData, /*bDiscardInternalCopy=*/ false);
+	return true;
+}
+
+bool GetTexture2DArraySliceTextureMips(const FString& DerivedDataKey, TArray<FCompressedImage2D>& OutMips)
+{
+	TArray<uint8> RawDerivedData;
+	if (!GetDerivedDataCacheRef().GetSynchronous(*DerivedDataKey, RawDerivedData))
+	{
+		return false;
+	}
+
+	FTexturePlatformData SliceData;
+	FMemoryReader Ar(RawDerivedData, /*bIsPersistent=*/ true);
+	SliceData.Serialize(Ar, NULL);
+
+	const int32 NumMips = SliceData.Mips.Num();
+	if (NumMips == 0 || SliceData.NumSlices != 1)
+	{
+		return false;
+	}
+
+	// Streamed mips are stored under their own keys, all of them must still be in the DDC and as big as their size and format require.
+	TArray<FCompressedImage2D> Mips;
+	Mips.AddDefaulted(NumMips);
+	for (int32 MipIndex = 0; MipIndex < NumMips; ++MipIndex)
+	{
+		FTexture2DMipMap& Mip = SliceData.Mips[MipIndex];
+		FCompressedImage2D& OutMip = Mips[MipIndex];
+		if (!LoadTexture2DArraySliceTextureMip(Mip, OutMip.RawData))
+		{
+			return false;
+		}
+
+		const int32 MipSize = CalcTextureMipMapSize(Mip.SizeX, Mip.SizeY, SliceData.PixelFormat, 0);
+		if (OutMip.RawData.Num() < MipSize)
+		{
+			UE_LOG(LogTexture, Warning, TEXT("Mip %d of %s holds %d bytes, %d expected for %dx%d %s, it is not reused."),
+				MipIndex, *DerivedDataKey, OutMip.RawData.Num(), MipSize, Mip.SizeX, Mip.SizeY, GPixelFormats[SliceData.PixelFormat].Name);
+			return false;
+		}
+
+		// The bulk data can be bigger because of memory alignment constraints, the array only keeps the mip itself.
+		OutMip.RawData.SetNum(MipSize);
+		OutMip.SizeX = Mip.SizeX;
+		OutMip.SizeY = Mip.SizeY;
+		OutMip.SizeZ = 1;
+		OutMip.PixelFormat = SliceData.PixelFormat;
+	}
+
+	OutMips = MoveTemp(Mips);
+	return true;
+}
+// FB Bulgakov End
+
 #endif // #if WITH_EDITOR
 
 /*------------------------------------------------------------------------------
@@ -344,7 +499,7 @@ static void GetTextureBuildSettings(
 	OutBuildSettings.CompositePower = Texture.CompositePower;
 	OutBuildSettings.LODBias = TextureLODSettings.CalculateLODBias(Texture.Source.GetSizeX(), Texture.Source.GetSizeY(), Texture.MaxTextureSize, Texture.LODGroup, Texture.LODBias, Texture.NumCinematicMipLevels, Texture.MipGenSettings);
 	OutBuildSettings.LODBiasWithCinematicMips = TextureLODSettings.CalculateLODBias(Texture.Source.GetSizeX(), Texture.Source.GetSizeY(), Texture.MaxTextureSize, Texture.LODGroup, Texture.LODBias, 0, Texture.MipGenSettings);
-	OutBuildSettings.bStreamable = bPlatformSupportsTextureStreaming && !Texture.NeverStream && (Texture.LODGroup != TEXTUREGROUP_UI) && (Cast<const UTexture2D>(&Texture) != NULL);
+	OutBuildSettings.bStreamable = bPlatformSupportsTextureStreaming && !Texture.NeverStream && (Texture.LODGroup != TEXTUREGROUP_UI) && (Cast<const UTexture2D>(&Texture) != NULL || Cast<const UTexture2DArray>(&Texture) != NULL); // FB Bulgakov - Texture2D Array
 	OutBuildSettings.PowerOfTwoMode = Texture.PowerOfTwoMode;
 	OutBuildSettings.PaddingColor = Texture.PaddingColor;
 	OutBuildSettings.ChromaKeyColor = Texture.ChromaKeyColor;
@@ -1064,10 +1219,14 @@ static void SerializePlatformData(
 		{
 			PlatformData->Mips[MipIndex + FirstMipToSerialize].BulkData.SetBulkDataFlags(BULKDATA_Force_NOT_InlinePayload);
 		}
+		// FB Bulgakov Begin - Texture2D Array
+		// Texture 2D arrays load their resident mips again for every streaming request, they must not be freed on first use.
+		const uint32 InlineMipFlags = Texture->IsA(UTexture2DArray::StaticClass()) ? BULKDATA_ForceInlinePayload : (BULKDATA_ForceInlinePayload | BULKDATA_SingleUse);
 		for (int32 MipIndex = MinMipToInline; MipIndex < NumMips; ++MipIndex)
 		{
-			PlatformData->Mips[MipIndex + FirstMipToSerialize].BulkData.SetBulkDataFlags(BULKDATA_ForceInlinePayload | BULKDATA_SingleUse);
+			PlatformData->Mips[MipIndex + FirstMipToSerialize].BulkData.SetBulkDataFlags(InlineMipFlags);
 		}
+		// FB Bulgakov End
 	}
 	Ar << NumMips;
 	if (Ar.IsLoading())
@@ -1235,6 +1394,14 @@ void UTexture::BeginCacheForCookedPlatformData( const ITargetPlatform *TargetPla
 			BuildSettingsToCache.Add(BuildSettings);
 		}
 
+		// FB Bulgakov Begin - Texture2D Array
+		// Recorded for every cook, the platform data may come straight from the DDC.
+		if (UTexture2DArray* Texture2DArray = Cast<UTexture2DArray>(this))
+		{
+			RecordTexture2DArraySlices(*Texture2DArray, BuildSettings);
+		}
+		// FB Bulgakov End
+
 		uint32 CacheFlags = ETextureCacheFlags::Async | ETextureCacheFlags::InlineMips;
 
 		// If source data is resident in memory then allow the texture to be built
@@ -16,6 +16,8 @@
 #include "RenderUtils.h"
 #include "TextureResource.h"
 #include "Engine/Texture.h"
+#include "Engine/Texture2DArray.h" // FB Bulgakov - Texture2D Array
+#include "Texture2DArrayDerivedData.h" // FB Bulgakov - Texture2D Array
 #include "DeviceProfiles/DeviceProfile.h"
 #include "DeviceProfiles/DeviceProfileManager.h"
 
@@ -145,7 +147,17 @@ void FTextureCacheDerivedDataWorker::BuildTexture()
 
 		// Compress the texture.
 		TArray<FCompressedImage2D> CompressedMips;
-		if (Compressor->BuildTexture(TextureData.Mips, CompositeTextureData.Mips, BuildSettings, CompressedMips))
+		// FB Bulgakov Begin - Texture2D Array
+		// Arrays are built slice by slice when possible so unchanged slices come straight from the DDC.
+		const UTexture2DArray* Texture2DArray = BuildSettings.bTexture2DArray ? Cast<UTexture2DArray>(&Texture) : nullptr;
+		const bool bBuiltFromSlices = Texture2DArray && !CompositeTextureData.Mips.Num() && BuildTexture2DArrayFromSlices(Compressor, *Texture2DArray, TextureData.Mips, BuildSettings, SliceTextureKeys, CompressedMips);
+		FTextureBuildSettings SingleImageBuildSettings = BuildSettings;
+		if (BuildSettings.bTexture2DArray)
+		{
+			AdjustTexture2DArraySingleImageBuildSettings(Texture, TextureData.Mips, SingleImageBuildSettings);
+		}
+		if (bBuiltFromSlices || Compressor->BuildTexture(TextureData.Mips, CompositeTextureData.Mips, SingleImageBuildSettings, CompressedMips))
+		// FB Bulgakov End
 		{
 			check(CompressedMips.Num());
 
@@ -246,11 +258,22 @@ FTextureCacheDerivedDataWorker::FTextureCacheDerivedDataWorker(
 		}
 	}
 
+	// FB Bulgakov Begin - Texture2D Array
+	// The slice textures are only read here, the array may be built on a worker thread.
+	if (BuildSettings.bTexture2DArray)
+	{
+		if (const UTexture2DArray* Texture2DArray = Cast<UTexture2DArray>(&Texture))
+		{
+			GetTexture2DArraySliceTextureDerivedDataKeys(*Texture2DArray, BuildSettings, SliceTextureKeys);
+		}
+	}
+	// FB Bulgakov End
+
 	// If the bulkdata is loaded and async build is allowed, get the source mips now (safe) to allow building the DDC if required.
 	// If the bulkdata is not loaded, the DDC will be built in Finalize() unless async loading is enabled (which won't allow reuse of the source for later use).
 	if (bAllowAsyncBuild)
 	{
-		if (TextureData.IsValid() && Texture.Source.IsBulkDataLoaded())
+		if (TextureData.IsValid() && Texture.Source.IsBulkDataLoaded() && Texture.Source.GetSizeOnDisk() > 0) // FB Bulgakov - Texture2D Array
 		{
 			TextureData.GetSourceMips(Texture.Source, ImageWrapper);
 		}
@@ -333,6 +356,16 @@ void FTextureCacheDerivedDataWorker::Finalize()
 	// This is a super edge case that should rarely happen.
 	if (!bSucceeded)
 	{
+		// FB Bulgakov Begin - Texture2D Array
+		// Reference only array sources are read back from their slices on a DDC miss.
+		// Slices that changed since can't be built under this key, the array is reassembled with a new source GUID instead.
+		UTexture2DArray* Texture2DArray = Cast<UTexture2DArray>(&Texture);
+		if (Texture2DArray && !Texture2DArray->LoadReferencedSourceSlices())
+		{
+			UE_LOG(LogTexture, Warning, TEXT("Skipped building %s, its slices changed since its source was assembled."), *Texture.GetPathName());
+			return;
+		}
+		// FB Bulgakov End
 		TextureData.GetSourceMips(Texture.Source, ImageWrapper);
 		if (Texture.CompositeTexture)
 		{
@@ -0,0 +1,182 @@
+#include "Engine/TextureRenderTarget2DArray.h"
+#include "TextureRenderTarget2DArrayResource.h"
+#include "RenderUtils.h"
+#include "RHIResources.h"
+#include "UnrealEngine.h"
+#include "DeviceProfiles/DeviceProfile.h"
+#include "DeviceProfiles/DeviceProfileManager.h"
+
+UTextureRenderTarget2DArray::UTextureRenderTarget2DArray(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	SizeX = 1;
+	SizeY = 1;
+	Slices = 1;
+	ClearColor = FLinearColor(0.0f, 1.0f, 0.0f, 1.0f);
+	AddressX = TA_Wrap;
+	AddressY = TA_Wrap;
+	bHDR = true;
+	bForceLinearGamma = true;
+	OverrideFormat = PF_Unknown;
+}
+
+void UTextureRenderTarget2DArray::Init(uint32 InSizeX, uint32 InSizeY, uint32 InSlices, EPixelFormat InFormat)
+{
+	check(InSizeX > 0 && InSizeY > 0 && InSlices > 0);
+	check(!(InSizeX % GPixelFormats[InFormat].BlockSizeX));
+	check(!(InSizeY % GPixelFormats[InFormat].BlockSizeY));
+
+	SizeX = InSizeX;
+	SizeY = InSizeY;
+	Slices = InSlices;
+	OverrideFormat = InFormat;
+
+	UpdateResource();
+}
+
+void UTextureRenderTarget2DArray::UpdateResourceImmediate(bool bClearRenderTarget)
+{
+	if (Resource)
+	{
+		FTextureRenderTarget2DArrayResource* InResource = static_cast<FTextureRenderTarget2DArrayResource*>(Resource);
+		ENQUEUE_RENDER_COMMAND(UpdateResourceImmediate)(
+			[InResource, bClearRenderTarget](FRHICommandListImmediate& RHICmdList)
+			{
+				InResource->UpdateDeferredResource(RHICmdList, bClearRenderTarget);
+			});
+	}
+}
+
+FTextureResource* UTextureRenderTarget2DArray::CreateResource()
+{
+	return new FTextureRenderTarget2DArrayResource(this);
+}
+
+#if WITH_EDITOR
+void UTextureRenderTarget2DArray::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	const int32 MaxSize = GetMax2DTextureDimension();
+	const EPixelFormat Format = GetFormat();
+
+	SizeX = FMath::Clamp<int32>(SizeX - (SizeX % GPixelFormats[Format].BlockSizeX), 1, MaxSize);
+	SizeY = FMath::Clamp<int32>(SizeY - (SizeY % GPixelFormats[Format].BlockSizeY), 1, MaxSize);
+	Slices = FMath::Clamp<int32>(Slices, 1, GetMaxTextureArrayLayers());
+
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+}
+#endif // WITH_EDITOR
+
+void UTextureRenderTarget2DArray::PostLoad()
+{
+	const int32 MaxSize = GetMax2DTextureDimension();
+	SizeX = FMath::Clamp<int32>(SizeX, 1, MaxSize);
+	SizeY = FMath::Clamp<int32>(SizeY, 1, MaxSize);
+	Slices = FMath::Clamp<int32>(Slices, 1, GetMaxTextureArrayLayers());
+
+	Super::PostLoad();
+}
+
+void UTextureRenderTarget2DArray::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+
+	// Calculate size based on format, every slice holds a single mip.
+	const EPixelFormat Format = GetFormat();
+	const int32 BlockSizeX = GPixelFormats[Format].BlockSizeX;
+	const int32 BlockSizeY = GPixelFormats[Format].BlockSizeY;
+	const int32 BlockBytes = GPixelFormats[Format].BlockBytes;
+	const int32 NumBlocksX = (SizeX + BlockSizeX - 1) / BlockSizeX;
+	const int32 NumBlocksY = (SizeY + BlockSizeY - 1) / BlockSizeY;
+	const int32 NumBytes = NumBlocksX * NumBlocksY * BlockBytes * Slices;
+
+	CumulativeResourceSize.AddDedicatedVideoMemoryBytes(NumBytes);
+}
+
+FString UTextureRenderTarget2DArray::GetDesc()
+{
+	return FString::Printf(TEXT("Render to Texture 2D Array %dx%dx%d [%s]"), SizeX, SizeY, Slices, GPixelFormats[GetFormat()].Name);
+}
+
+FTextureRenderTarget2DArrayResource::FTextureRenderTarget2DArrayResource(const UTextureRenderTarget2DArray* InOwner)
+	: Owner(InOwner)
+	, ClearColor(InOwner->ClearColor)
+	, Format(InOwner->GetFormat())
+	, TargetSizeX(InOwner->SizeX)
+	, TargetSizeY(InOwner->SizeY)
+	, TargetSlices(InOwner->Slices)
+{
+}
+
+void FTextureRenderTarget2DArrayResource::InitDynamicRHI()
+{
+	if (TargetSizeX > 0 && TargetSizeY > 0 && TargetSlices > 0)
+	{
+		// The texture can be sampled in sRGB space as the slices are rendered in linear space.
+		const bool bSRGB = !Owner->bForceLinearGamma && !Owner->bHDR && Owner->OverrideFormat == PF_Unknown;
+		const uint32 CreationFlags = TexCreate_RenderTargetable | TexCreate_ShaderResource | (bSRGB ? TexCreate_SRGB : 0);
+
+		FRHIResourceCreateInfo CreateInfo(FClearValueBinding(ClearColor));
+		Texture2DArrayRHI = RHICreateTexture2DArray(TargetSizeX, TargetSizeY, TargetSlices, Format, 1, CreationFlags, CreateInfo);
+		TextureRHI = Texture2DArrayRHI;
+		TextureRHI->SetName(Owner->GetFName());
+		RHIBindDebugLabelName(TextureRHI, *Owner->GetName());
+		RHIUpdateTextureReference(Owner->TextureReference.TextureReferenceRHI, TextureRHI);
+
+		AddToDeferredUpdateList(true);
+	}
+
+	// Create the sampler state RHI resource.
+	FSamplerStateInitializerRHI SamplerStateInitializer
+	(
+		(ESamplerFilter)UDeviceProfileManager::Get().GetActiveProfile()->GetTextureLODSettings()->GetSamplerFilter(Owner),
+		Owner->AddressX == TA_Wrap ? AM_Wrap : (Owner->AddressX == TA_Clamp ? AM_Clamp : AM_Mirror),
+		Owner->AddressY == TA_Wrap ? AM_Wrap : (Owner->AddressY == TA_Clamp ? AM_Clamp : AM_Mirror),
+		AM_Wrap
+	);
+	SamplerStateRHI = RHICreateSamplerState(SamplerStateInitializer);
+}
+
+void FTextureRenderTarget2DArrayResource::ReleaseDynamicRHI()
+{
+	RHIUpdateTextureReference(Owner->TextureReference.TextureReferenceRHI, FTextureRHIParamRef());
+	Texture2DArrayRHI.SafeRelease();
+	TextureRHI.SafeRelease();
+
+	RemoveFromDeferredUpdateList();
+}
+
+void FTextureRenderTarget2DArrayResource::UpdateDeferredResource(FRHICommandListImmediate& RHICmdList, bool bClearRenderTarget)
+{
+	RemoveFromDeferredUpdateList();
+
+	if (bClearRenderTarget && Texture2DArrayRHI)
+	{
+		// An array slice of -1 binds every slice, they are all cleared at once.
+		FRHIRenderPassInfo RPInfo(Texture2DArrayRHI, ERenderTargetActions::Clear_Store);
+		RPInfo.ColorRenderTargets[0].ArraySlice = -1;
+		TransitionRenderPassTargets(RHICmdList, RPInfo);
+		RHICmdList.BeginRenderPass(RPInfo, TEXT("ClearTextureRenderTarget2DArray"));
+		RHICmdList.EndRenderPass();
+		RHICmdList.TransitionResource(EResourceTransitionAccess::EReadable, Texture2DArrayRHI);
+	}
+}
+
+float FTextureRenderTarget2DArrayResource::GetDisplayGamma() const
+{
+	if (Owner->TargetGamma > KINDA_SMALL_NUMBER * 10)
+	{
+		return Owner->TargetGamma;
+	}
+	if (Format == PF_FloatRGB || Format == PF_FloatRGBA || Owner->bForceLinearGamma)
+	{
+		return 1.0f;
+	}
+	return FTextureRenderTargetResource::GetDisplayGamma();
+}
+
+FRHIRenderTargetView FTextureRenderTarget2DArrayResource::GetSliceRenderTargetView(int32 SliceIndex, ERenderTargetLoadAction LoadAction) const
+{
+	check(IsInRenderingThread());
+	check(SliceIndex >= 0 && SliceIndex < (int32)TargetSlices);
+	return FRHIRenderTargetView(Texture2DArrayRHI, 0, SliceIndex, LoadAction, ERenderTargetStoreAction::EStore);
+}
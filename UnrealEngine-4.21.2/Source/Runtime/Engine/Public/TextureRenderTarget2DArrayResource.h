@@ -0,0 +1,58 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TextureResource.h"
+
+class UTextureRenderTarget2DArray;
+
+/**
+ * Render target resource of a UTextureRenderTarget2DArray.
+ * The texture is created with a single mip and is both render targetable and sampled, there is no resolve.
+ */
+class FTextureRenderTarget2DArrayResource : public FTextureRenderTargetResource
+{
+public:
+	FTextureRenderTarget2DArrayResource(const UTextureRenderTarget2DArray* InOwner);
+
+	//~ Begin FRenderResource Interface
+	void InitDynamicRHI() override;
+	void ReleaseDynamicRHI() override;
+	//~ End FRenderResource Interface
+
+	//~ Begin FDeferredUpdateResource Interface
+	void UpdateDeferredResource(FRHICommandListImmediate& RHICmdList, bool bClearRenderTarget = true) override;
+	//~ End FDeferredUpdateResource Interface
+
+	uint32 GetSizeX() const override { return TargetSizeX; }
+	uint32 GetSizeY() const override { return TargetSizeY; }
+	FIntPoint GetSizeXY() const override { return FIntPoint(TargetSizeX, TargetSizeY); }
+	float GetDisplayGamma() const override;
+
+	/** Number of slices of the texture. */
+	uint32 GetNumSlices() const { return TargetSlices; }
+
+	/** The texture 2D array, null until the resource is initialized. */
+	FTexture2DArrayRHIParamRef GetTexture2DArrayRHI() const { return Texture2DArrayRHI; }
+
+	/**
+	 * Render target view of a single slice, to render into it. Render thread only.
+	 *
+	 * @param	SliceIndex		The slice to render to.
+	 * @param	LoadAction		What to do with the previous content of the slice.
+	 */
+	ENGINE_API FRHIRenderTargetView GetSliceRenderTargetView(int32 SliceIndex, ERenderTargetLoadAction LoadAction = ERenderTargetLoadAction::ELoad) const;
+
+private:
+	/** The UTextureRenderTarget2DArray which this resource represents. */
+	const UTextureRenderTarget2DArray* Owner;
+
+	/** Texture resource used for rendering with and resolving to. */
+	FTexture2DArrayRHIRef Texture2DArrayRHI;
+
+	/** The color the texture is cleared to. */
+	FLinearColor ClearColor;
+	EPixelFormat Format;
+	uint32 TargetSizeX;
+	uint32 TargetSizeY;
+	uint32 TargetSlices;
+};